@@ -4,9 +4,6 @@
 #include <iostream>
 #include "AnalysisToolBase.h"
 
-#include "TDatabasePDG.h"
-#include "TParticlePDG.h"
-
 #include "nusimdata/SimulationBase/MCTruth.h"
 #include "lardataobj/MCBase/MCShower.h"
 #include "TVector3.h"
@@ -15,6 +12,8 @@
 #include "CommonFunctions/Scores.h"
 #include "CommonFunctions/Corrections.h"
 #include "CommonFunctions/Scatters.h"
+#include "CommonFunctions/MCParticleGraph.h"
+#include "CommonFunctions/InteractionChains.h"
 #include "CommonFunctions/Geometry.h"
 #include "CommonFunctions/Pandora.h"
 
@@ -101,7 +100,7 @@ public:
         p.true_vtx_sce_w_wire = (common::ProjectToWireView(p.true_vtx_sce_x, p.true_vtx_sce_y, p.true_vtx_sce_z, common::TPC_VIEW_W)).Z(); 
     }
 
-    void fillParticle(const art::ValidHandle<std::vector<simb::MCParticle>>& mcp_h, const art::Ptr<simb::MCParticle>& particle, Particle& p)
+    void fillParticle(const common::MCParticleGraph& graph, const common::InteractionChains& chains, const art::Ptr<simb::MCParticle>& particle, Particle& p)
     {
         p.tid = particle->TrackId();
         p.pdg = particle->PdgCode();
@@ -118,13 +117,33 @@ public:
 
         if (abs(particle->PdgCode()) == 211)
         {
-            art::Ptr<simb::MCParticle> final_scatter_particle;
-            common::GetNScatters(mcp_h, particle, final_scatter_particle, p.n_elas, p.n_inelas);
+            const int index = graph.find(particle);
+            if (index == common::MCParticleGraph::kNone)
+            {
+                p.endstate = common::GetEndStateName(common::EndState::kNone);
+                return;
+            }
 
-            p.endstate = common::GetEndState(particle, mcp_h);
+            p.n_elas += chains.nElastic(index);
+            p.n_inelas += chains.nInelastic(index);
+            p.endstate = common::GetEndStateName(chains.endState(index));
         }
     }
 
+    // Particle graph and interaction chains of the event, rebuilt only when the event changes
+    const common::MCParticleGraph& particleGraph(art::Event const& e)
+    {
+        if (_graph.isFor(e))
+            return _graph;
+
+        _graph.build(e, _MCPproducer);
+        if (_graph.nDuplicates() > 0)
+            throw cet::exception("EventCategoryAnalysis") << " - Found " << _graph.nDuplicates() << " repeated MCParticle TrackIds." << std::endl;
+
+        _chains.build(_graph);
+        return _graph;
+    }
+
 private:
     art::InputTag _MCTproducer;
     art::InputTag _MCPproducer;
@@ -138,19 +157,12 @@ private:
     art::InputTag _PCAproducer;
     art::InputTag _SHRproducer;
 
+    common::MCParticleGraph _graph;
+    common::InteractionChains _chains;
+
     float _PionThreshold;
     float _MuonThreshold;
 
-    TParticlePDG *neutral_kaon = TDatabasePDG::Instance()->GetParticle(311);
-    TParticlePDG *kaon_short = TDatabasePDG::Instance()->GetParticle(310);
-    TParticlePDG *kaon_long = TDatabasePDG::Instance()->GetParticle(130);
-    TParticlePDG *lambda = TDatabasePDG::Instance()->GetParticle(3122);
-    TParticlePDG *sigma_plus = TDatabasePDG::Instance()->GetParticle(3222); 
-    TParticlePDG *sigma_minus = TDatabasePDG::Instance()->GetParticle(3112);
-    TParticlePDG *sigma_zero = TDatabasePDG::Instance()->GetParticle(3212);
-    TParticlePDG *muon = TDatabasePDG::Instance()->GetParticle(13);
-    TParticlePDG *pion = TDatabasePDG::Instance()->GetParticle(211);
-
     bool _pass_preselection;
 
     Neutrino _neutrino;
@@ -207,14 +219,8 @@ void EventCategoryAnalysis::analyzeEvent(art::Event const &e, bool is_data)
         return;
   
     auto const &mct_h = e.getValidHandle<std::vector<simb::MCTruth>>(_MCTproducer);
-    auto const &mcp_h = e.getValidHandle<std::vector<simb::MCParticle>>(_MCPproducer);
-
-    std::map<int, art::Ptr<simb::MCParticle>> mcp_map;
-    for (size_t d = 0; d < mcp_h->size(); d++)
-    {
-        const art::Ptr<simb::MCParticle> mcp(mcp_h, d);
-        mcp_map[mcp->TrackId()] = mcp;
-    }
+    const common::MCParticleGraph &graph = this->particleGraph(e);
+    const common::InteractionChains &chains = _chains;
 
     auto mct = mct_h->at(0);
     _found_signature = false;
@@ -227,35 +233,38 @@ void EventCategoryAnalysis::analyzeEvent(art::Event const &e, bool is_data)
 
         if (neutrino.CCNC() != simb::kCC) return;
         auto lepton = neutrino.Lepton();
-        if (abs(lepton.PdgCode()) != muon->PdgCode() ||  TVector3(lepton.Px(), lepton.Py(), lepton.Pz()).Mag() < _MuonThreshold)
+        if (abs(lepton.PdgCode()) != 13 ||  TVector3(lepton.Px(), lepton.Py(), lepton.Pz()).Mag() < _MuonThreshold)
             return;
         else
         {
-            art::Ptr<simb::MCParticle> lepton_ptr = mcp_map[lepton.TrackId()];
-            fillParticle(mcp_h, lepton_ptr, _mcp_mu);
+            const int lepton_index = graph.find(lepton.TrackId());
+            art::Ptr<simb::MCParticle> lepton_ptr = lepton_index != common::MCParticleGraph::kNone ? graph.particle(lepton_index) : art::Ptr<simb::MCParticle>();
+            fillParticle(graph, chains, lepton_ptr, _mcp_mu);
         }
 
-        for (const auto &t_part : *mcp_h)
+        for (size_t i = 0; i < graph.size(); ++i)
         {
-            if (t_part.Process() != "primary") 
+            if (graph.process(i) != common::Process::kPrimary) 
                 continue;
 
-            _final_state.push_back(t_part.PdgCode());
+            _final_state.push_back(graph.particle(i)->PdgCode());
         }
 
-        for (const auto &t_part : *mcp_h) 
+        for (size_t i = 0; i < graph.size(); ++i) 
         {
-            if (abs(t_part.PdgCode()) == neutral_kaon->PdgCode() && t_part.Process() == "primary" && t_part.EndProcess() == "Decay" && t_part.NumberDaughters() == 1 && !_found_signature) 
+            const simb::MCParticle &t_part = *graph.particle(i);
+            if (abs(t_part.PdgCode()) == 311 && graph.process(i) == common::Process::kPrimary && graph.endProcess(i) == common::Process::kDecay && t_part.NumberDaughters() == 1 && !_found_signature) 
             {
-                std::vector<art::Ptr<simb::MCParticle>> dtrs = common::GetDaughters(mcp_map.at(t_part.TrackId()), mcp_map);
+                const auto dtrs = graph.daughters(graph.find(t_part.TrackId()));
                 if (dtrs.size() != 1) 
                     continue; 
 
-                auto g_part = dtrs.at(0);
-                if (g_part->PdgCode() == kaon_short->PdgCode() && g_part->Process() == "Decay" && g_part->EndProcess() == "Decay" && g_part->NumberDaughters() == 2 && !_found_signature)
+                const int g_index = dtrs[0];
+                auto g_part = graph.particle(g_index);
+                if (g_part->PdgCode() == 310 && graph.process(g_index) == common::Process::kDecay && graph.endProcess(g_index) == common::Process::kDecay && g_part->NumberDaughters() == 2 && !_found_signature)
                 {
-                    fillParticle(mcp_h, g_part, _mcp_kshort);
-                    auto daughters = common::GetDaughters(mcp_map.at(g_part->TrackId()), mcp_map);
+                    fillParticle(graph, chains, g_part, _mcp_kshort);
+                    auto daughters = common::GetDaughters(g_part, graph);
                     if (daughters.size() == 2) 
                     {
                         std::vector<int> exp_dtrs = {-211, 211};
@@ -272,20 +281,11 @@ void EventCategoryAnalysis::analyzeEvent(art::Event const &e, bool is_data)
                         {
                             for (const auto &dtr : daughters) 
                             {
-                                unsigned int n_elas = 0;
-                                unsigned int n_inelas = 0;
-
-                                art::Ptr<simb::MCParticle> scat_part;
-                                std::string scat_end_process;
-
-                                common::GetNScatters(mcp_h, dtr, scat_part, n_elas, n_inelas);
-                                scat_end_process = common::GetEndState(dtr, mcp_h);
-
                                 if (dtr->PdgCode() == 211) // pion-plus
-                                    fillParticle(mcp_h, dtr, _mcp_piplus);
+                                    fillParticle(graph, chains, dtr, _mcp_piplus);
                                 
                                 else if (dtr->PdgCode() == -211) // pion-minus
-                                    fillParticle(mcp_h, dtr, _mcp_piminus);
+                                    fillParticle(graph, chains, dtr, _mcp_piminus);
                             }
 
                             _found_signature = std::all_of(daughters.begin(), daughters.end(), [&](const auto &dtr) 
@@ -360,27 +360,20 @@ void EventCategoryAnalysis::analyzeSlice(art::Event const &e, std::vector<common
         art::ValidHandle<std::vector<recob::Hit>> in_hits = e.getValidHandle<std::vector<recob::Hit>>(_Hproducer);
         std::unique_ptr<art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>> mcp_bkth_assoc = std::unique_ptr<art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>>(new art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>(in_hits, e, _BacktrackTag));
 
-        int mcp_mu_hits = 0, mcp_piplus_hits = 0, mcp_piminus_hits = 0;
+        std::vector<common::BtPart> btparts_v;
+        for (const Particle *p : {&_mcp_mu, &_mcp_piplus, &_mcp_piminus})
+            btparts_v.emplace_back(p->pdg, p->px, p->py, p->pz, p->energy, static_cast<unsigned int>(p->tid));
+
+        common::BtPartIndex btindex(btparts_v);
+        std::vector<unsigned int> mcp_hits(btparts_v.size(), 0);
         for (unsigned int ih = 0; ih < in_hits->size(); ih++)
-        {
-            auto assmcp = mcp_bkth_assoc->at(ih);
-            auto assmdt = mcp_bkth_assoc->data(ih);
-            for (unsigned int ia = 0; ia < assmcp.size(); ++ia)
-            {
-                auto mcp = assmcp[ia];
-                auto amd = assmdt[ia];
-                if (amd->isMaxIDE != 1)
-                    continue;
-
-                if (mcp->TrackId() == _mcp_mu.tid)
-                    mcp_mu_hits++;
-                else if (mcp->TrackId() == _mcp_piplus.tid)
-                    mcp_piplus_hits++;
-                else if (mcp->TrackId() == _mcp_piminus.tid)
-                    mcp_piminus_hits++;
-            }
-        }
+            common::countBtPartHits(ih, mcp_bkth_assoc, btindex, mcp_hits);
 
+        for (size_t ib = 0; ib < btparts_v.size(); ++ib)
+            btparts_v[ib].nhits = mcp_hits[ib];
+
+        std::vector<size_t> pfp_ids;
+        std::vector<std::vector<art::Ptr<recob::Hit>>> pfp_hits_v;
         for (const common::ProxyPfpElem_t &pfp_pxy : slice_pfp_v)
         {
             if (pfp_pxy->IsPrimary())
@@ -398,39 +391,26 @@ void EventCategoryAnalysis::analyzeSlice(art::Event const &e, std::vector<common
                     pfp_hits.push_back(hit);
             } 
 
-            std::vector<simb::MCParticle> assmcp;
-            std::vector<anab::BackTrackerHitMatchingData> amd;
+            pfp_ids.push_back(pfp_pxy->Self());
+            pfp_hits_v.push_back(std::move(pfp_hits));
+        }
 
-            int pfp_mu_hits = 0, pfp_piplus_hits = 0, pfp_piminus_hits = 0;
-            for (auto hit : pfp_hits)
-            {
-                auto assmcp = mcp_bkth_assoc->at(hit.key());       
-                auto assmdt = mcp_bkth_assoc->data(hit.key());    
-                for (size_t i = 0; i < assmcp.size(); i++)
-                {
-                    if (assmdt[i]->isMaxIDE != 1) 
-                        continue;
-
-                    const int track_id = assmcp[i]->TrackId();
-                    if (track_id == _mcp_mu.tid)
-                        pfp_mu_hits++;
-                    else if (track_id == _mcp_piplus.tid)
-                        pfp_piplus_hits++;
-                    else if (track_id == _mcp_piminus.tid)
-                        pfp_piminus_hits++;
-                }
-            }
+        const std::vector<common::BtPartMatch> matches = common::getAssocBtParts(pfp_hits_v, mcp_bkth_assoc, btparts_v, btindex);
+        for (size_t ip = 0; ip < matches.size(); ++ip)
+        {
+            const size_t n_pfp_hits = pfp_hits_v[ip].size();
+            const std::vector<unsigned int> &pfp_hits = matches[ip].bthits;
 
-            float muon_purity = (pfp_hits.size() > 0) ? static_cast<float>(pfp_mu_hits) / pfp_hits.size() : 0.0f;
-            float muon_comple = (mcp_mu_hits > 0) ? static_cast<float>(pfp_mu_hits) / mcp_mu_hits : 0.0f;
+            float muon_purity = (n_pfp_hits > 0) ? static_cast<float>(pfp_hits[0]) / n_pfp_hits : 0.0f;
+            float muon_comple = (mcp_hits[0] > 0) ? static_cast<float>(pfp_hits[0]) / mcp_hits[0] : 0.0f;
 
-            float piplus_purity = (pfp_hits.size() > 0) ? static_cast<float>(pfp_piplus_hits) / pfp_hits.size() : 0.0f;
-            float piplus_comple = (mcp_piplus_hits > 0) ? static_cast<float>(pfp_piplus_hits) / mcp_piplus_hits : 0.0f;
+            float piplus_purity = (n_pfp_hits > 0) ? static_cast<float>(pfp_hits[1]) / n_pfp_hits : 0.0f;
+            float piplus_comple = (mcp_hits[1] > 0) ? static_cast<float>(pfp_hits[1]) / mcp_hits[1] : 0.0f;
 
-            float piminus_purity = (pfp_hits.size() > 0) ? static_cast<float>(pfp_piminus_hits) / pfp_hits.size() : 0.0f;
-            float piminus_comple = (mcp_piminus_hits > 0) ? static_cast<float>(pfp_piminus_hits) / mcp_piminus_hits : 0.0f;
+            float piminus_purity = (n_pfp_hits > 0) ? static_cast<float>(pfp_hits[2]) / n_pfp_hits : 0.0f;
+            float piminus_comple = (mcp_hits[2] > 0) ? static_cast<float>(pfp_hits[2]) / mcp_hits[2] : 0.0f;
 
-            _mcp_pfp_id_v.push_back(pfp_pxy->Self());
+            _mcp_pfp_id_v.push_back(pfp_ids[ip]);
             _mcp_mu_purity_v.push_back(muon_purity);
             _mcp_mu_comple_v.push_back(muon_comple);
             _mcp_piplus_purity_v.push_back(piplus_purity);
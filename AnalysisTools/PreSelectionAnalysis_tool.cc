@@ -15,6 +15,7 @@
 #include "CommonFunctions/Corrections.h"
 #include "CommonFunctions/Scatters.h"
 #include "CommonFunctions/Pandora.h"
+#include "CommonFunctions/HitTruthOwners.h"
 
 #include "lardataobj/AnalysisBase/BackTrackerMatchingData.h"
 #include "lardataobj/AnalysisBase/Calorimetry.h"
@@ -55,6 +56,7 @@ private:
     art::InputTag _PandoraModuleLabel;
     art::InputTag _HitModuleLabel;
     art::InputTag _BacktrackModuleLabel;
+    art::InputTag _HitTruthOwnerLabel;
     art::InputTag _FlashMatchModuleLabel;
     art::InputTag _SpacePointModuleLabel;
     art::InputTag _PFParticleModuleLabel;
@@ -105,6 +107,8 @@ private:
     float _flash_reco_nu_vtx_y;
     float _flash_reco_nu_vtx_z;
 
+    common::ProcessInterner _interner;
+
     bool _debug;
 };
 
@@ -115,6 +119,7 @@ PreSelectionAnalysis::PreSelectionAnalysis(const fhicl::ParameterSet &pset)
     _PandoraModuleLabel = pset.get<std::string>("PandoraModuleLabel", "pandora");
     _HitModuleLabel = pset.get<std::string>("HitModuleLabel", "gaushit");
     _BacktrackModuleLabel = pset.get<std::string>("BacktrackModuleLabel", "gaushitTruthMatch");
+    _HitTruthOwnerLabel = pset.get<std::string>("HitTruthOwnerLabel", "");
     _FlashMatchModuleLabel = pset.get<std::string>("FlashMatchModuleLabel", "pandora");
     _PFParticleModuleLabel = pset.get<std::string>("PFParticleModuleLabel", "pandora");
     _SpacePointModuleLabel = pset.get<std::string>("SpacePointModuleLabel", "pandora"); 
@@ -157,7 +162,8 @@ void PreSelectionAnalysis::analyzeEvent(art::Event const &e, bool fData)
         throw cet::exception("PreSelectionAnalysis") << "Failed to find any hits in event" << std::endl;
     art::fill_ptr_vector(hit_vector, hit_handle);
 
-    art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData> assoc_mc_part = art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>(hit_handle, e, _BacktrackModuleLabel);
+    common::HitTruthOwners truth_owners;
+    common::LoadHitTruthOwners(e, hit_handle, _HitTruthOwnerLabel, _BacktrackModuleLabel, _interner, truth_owners);
 
     art::Handle<std::vector<recob::Slice>> slice_handle; 
     std::vector<art::Ptr<recob::Slice>> slice_vector;
@@ -206,22 +212,18 @@ void PreSelectionAnalysis::analyzeEvent(art::Event const &e, bool fData)
     for (unsigned int i_h = 0; i_h < hit_vector.size(); i_h++)
     {
         const art::Ptr<recob::Hit> &hit = hit_vector[i_h];
-        const std::vector<art::Ptr<simb::MCParticle>> &matched_mc_part_vector = assoc_mc_part.at(hit.key());
-        auto matched_data_vector = assoc_mc_part.data(hit.key());
-
-        for (unsigned int i_p = 0; i_p < matched_mc_part_vector.size(); i_p++)
-        {
-            const art::Ptr<simb::MCParticle> &matched_mc_part = matched_mc_part_vector.at(i_p);
-            auto matched_data = matched_data_vector.at(i_p);
-
-            if (matched_data->isMaxIDE != 1)
-                continue;
+        const int owner_id = truth_owners.trackId(hit);
+        if (owner_id == common::kNoTruthOwner)
+            continue;
 
-            const int track_idx = common::isParticleElectromagnetic(matched_mc_part) ? common::getLeadElectromagneticTrack(matched_mc_part, mc_particle_map) : matched_mc_part->TrackId();
+        // An owner missing from the particle map is recorded under its own TrackId
+        const auto matched_mc_part = mc_particle_map.find(owner_id);
+        int track_idx = owner_id;
+        if (matched_mc_part != mc_particle_map.end() && common::isParticleElectromagnetic(matched_mc_part->second))
+            track_idx = common::getLeadElectromagneticTrack(matched_mc_part->second, mc_particle_map);
 
-            hit_to_track_id[hit.key()] = track_idx;
-            track_id_to_hits[track_idx].push_back(hit);
-        }
+        hit_to_track_id[hit.key()] = track_idx;
+        track_id_to_hits[track_idx].push_back(hit);
     }
 
     // find slice overall information and true neutrino slice
@@ -4,16 +4,15 @@
 #include <iostream>
 #include "AnalysisToolBase.h"
 
-#include "TDatabasePDG.h"
-#include "TParticlePDG.h"
-
 #include "CommonFunctions/Types.h"
 #include "CommonFunctions/Backtracking.h"
 #include "CommonFunctions/Scores.h"
 #include "CommonFunctions/Identification.h"
 #include "CommonFunctions/Corrections.h"
+#include "CommonFunctions/SCEGrid.h"
 #include "CommonFunctions/Geometry.h"
 #include "CommonFunctions/Calibration.h"
+#include "CommonFunctions/ParticleTable.h"
 
 #include "larreco/RecoAlg/TrajectoryMCSFitter.h"
 #include "ubana/ParticleID/Algorithms/uB_PlaneIDBitsetHelperFunctions.h"
@@ -46,9 +45,6 @@ private:
     const trkf::TrackMomentumCalculator _trkmom;
     const trkf::TrajectoryMCSFitter _mcsfitter;
 
-    TParticlePDG *proton = TDatabasePDG::Instance()->GetParticle(2212);
-    TParticlePDG *muon = TDatabasePDG::Instance()->GetParticle(13);
-    TParticlePDG *pion = TDatabasePDG::Instance()->GetParticle(211);
 
     art::InputTag _CALOproducer;
     art::InputTag _PIDproducer;
@@ -62,6 +58,9 @@ private:
     std::vector<float> _ADCtoE; 
     float _EndSpacepointDistance;
 
+    double _SCEGridSpacing;
+    common::SCEGrid _sce_grid;
+
     std::vector<size_t> _trk_pfp_id_v;
     std::vector<float> _trk_score_v;
 
@@ -179,6 +178,7 @@ TrackAnalysis::TrackAnalysis(const fhicl::ParameterSet &p) : _mcsfitter(fhicl::T
     _RecalibrateHits = p.get<bool>("RecalibrateHits", false);
     _ADCtoE = p.get<std::vector<float>>("ADCtoE");
     _EndSpacepointDistance = p.get<float>("EndSpacepointDistance", 5.0);
+    _SCEGridSpacing = p.get<double>("SCEGridSpacing", 5.0);
 }
 
 void TrackAnalysis::configure(fhicl::ParameterSet const &p)
@@ -229,6 +229,18 @@ void TrackAnalysis::analyzeSlice(art::Event const &e, std::vector<common::ProxyP
         sp_v.emplace_back(sp_handle, i_sp);
     }
 
+    if (!_sce_grid.built())
+        _sce_grid.build(common::SCEGrid::Offsets::kCalSpatial, _SCEGridSpacing);
+
+    // Every track compares its end with all the spacepoints, so correct them once for the slice
+    std::vector<float> sp_x(sp_v.size()), sp_y(sp_v.size()), sp_z(sp_v.size());
+    for (size_t i_sp = 0; i_sp < sp_v.size(); i_sp++) {
+        sp_x[i_sp] = sp_v[i_sp]->XYZ()[0];
+        sp_y[i_sp] = sp_v[i_sp]->XYZ()[1];
+        sp_z[i_sp] = sp_v[i_sp]->XYZ()[2];
+    }
+    _sce_grid.map(sp_v.size(), sp_x.data(), sp_y.data(), sp_z.data());
+
     for (size_t i_pfp = 0; i_pfp < slice_pfp_v.size(); i_pfp++)
     {
         auto pfp = slice_pfp_v[i_pfp];
@@ -369,9 +381,12 @@ void TrackAnalysis::analyzeSlice(art::Event const &e, std::vector<common::ProxyP
             _trk_pida_v_v.push_back(pida_mean_v);
 
             float mcs_momentum_muon = _mcsfitter.fitMcs(trk->Trajectory(), 13).bestMomentum();
-            float range_momentum_muon = _trkmom.GetTrackMomentum(common::GetSCECorrTrackLength(trk), 13);
-            float energy_proton = std::sqrt(std::pow(_trkmom.GetTrackMomentum(common::GetSCECorrTrackLength(trk), 2212), 2) + std::pow(proton->Mass(), 2)) - proton->Mass();
-            float energy_muon = std::sqrt(std::pow(mcs_momentum_muon, 2) + std::pow(muon->Mass(), 2)) - muon->Mass();
+            const float trk_len_sce = common::GetSCECorrTrackLength(trk, _sce_grid);
+            float range_momentum_muon = _trkmom.GetTrackMomentum(trk_len_sce, 13);
+            constexpr double proton_mass = common::ParticleMass(2212);
+            constexpr double muon_mass = common::ParticleMass(13);
+            float energy_proton = std::sqrt(std::pow(_trkmom.GetTrackMomentum(trk_len_sce, 2212), 2) + std::pow(proton_mass, 2)) - proton_mass;
+            float energy_muon = std::sqrt(std::pow(mcs_momentum_muon, 2) + std::pow(muon_mass, 2)) - muon_mass;
 
             _trk_mcs_muon_mom_v.push_back(mcs_momentum_muon);
             _trk_range_muon_mom_v.push_back(range_momentum_muon);
@@ -389,8 +404,8 @@ void TrackAnalysis::analyzeSlice(art::Event const &e, std::vector<common::ProxyP
             _trk_start_y_v.push_back(trk->Start().Y());
             _trk_start_z_v.push_back(trk->Start().Z());
 
-            float _trk_start_sce[3];
-            common::ApplySCECorrectionXYZ(trk->Start().X(), trk->Start().Y(), trk->Start().Z(), _trk_start_sce);
+            float _trk_start_sce[3] = {static_cast<float>(trk->Start().X()), static_cast<float>(trk->Start().Y()), static_cast<float>(trk->Start().Z())};
+            _sce_grid.map(_trk_start_sce[0], _trk_start_sce[1], _trk_start_sce[2]);
             _trk_sce_start_x_v.push_back(_trk_start_sce[0]);
             _trk_sce_start_y_v.push_back(_trk_start_sce[1]);
             _trk_sce_start_z_v.push_back(_trk_start_sce[2]);
@@ -399,8 +414,8 @@ void TrackAnalysis::analyzeSlice(art::Event const &e, std::vector<common::ProxyP
             _trk_end_y_v.push_back(trk->End().Y());
             _trk_end_z_v.push_back(trk->End().Z());
 
-            float _trk_end_sce[3];
-            common::ApplySCECorrectionXYZ(trk->End().X(), trk->End().Y(), trk->End().Z(), _trk_end_sce);
+            float _trk_end_sce[3] = {static_cast<float>(trk->End().X()), static_cast<float>(trk->End().Y()), static_cast<float>(trk->End().Z())};
+            _sce_grid.map(_trk_end_sce[0], _trk_end_sce[1], _trk_end_sce[2]);
             _trk_sce_end_x_v.push_back(_trk_end_sce[0]);
             _trk_sce_end_y_v.push_back(_trk_end_sce[1]);
             _trk_sce_end_z_v.push_back(_trk_end_sce[2]);
@@ -408,7 +423,7 @@ void TrackAnalysis::analyzeSlice(art::Event const &e, std::vector<common::ProxyP
             _trk_theta_v.push_back(trk->Theta());
             _trk_phi_v.push_back(trk->Phi());
 
-            _trk_len_v.push_back(common::GetSCECorrTrackLength(trk));
+            _trk_len_v.push_back(trk_len_sce);
 
             TVector3 trk_vtx_v;
             trk_vtx_v.SetXYZ(trk->Start().X(), trk->Start().Y(), trk->Start().Z());
@@ -483,10 +498,8 @@ void TrackAnalysis::analyzeSlice(art::Event const &e, std::vector<common::ProxyP
             int nPoints = 0;
             float distSquared = _EndSpacepointDistance*_EndSpacepointDistance;
             TVector3 trkEnd(_trk_end_sce[0], _trk_end_sce[1], _trk_end_sce[2]);
-            for (auto &sp : sp_v) {
-                float _sp_sce[3];
-                common::ApplySCECorrectionXYZ(sp->XYZ()[0], sp->XYZ()[1], sp->XYZ()[2], _sp_sce);
-                TVector3 spacePoint(_sp_sce[0], _sp_sce[1], _sp_sce[2]);
+            for (size_t i_sp = 0; i_sp < sp_v.size(); i_sp++) {
+                TVector3 spacePoint(sp_x[i_sp], sp_y[i_sp], sp_z[i_sp]);
                 if ((trkEnd - spacePoint).Mag2() < distSquared) 
                     nPoints++;
             }
@@ -23,6 +23,10 @@
 #include "CommonFunctions/Region.h"
 #include "CommonFunctions/Types.h"
 #include "CommonFunctions/BadChannels.h"
+#include "CommonFunctions/HitTable.h"
+#include "CommonFunctions/WireGeometry.h"
+#include "CommonFunctions/EventTruthContext.h"
+#include "CommonFunctions/SCEGrid.h"
 
 #include "art/Utilities/ToolMacros.h"
 #include "art/Utilities/make_tool.h"
@@ -43,6 +47,7 @@
 #include <unordered_map>
 #include <cmath>
 #include <chrono>
+#include <memory>
 
 namespace claritytools {
 
@@ -57,6 +62,8 @@ public:
     , _BacktrackTag{pset.get<art::InputTag>("BacktrackTag", "gaushitTruthMatch")}
     , _DeadChannelTag{pset.get<art::InputTag>("DeadChannelTag")}
     , _verbose{pset.get<bool>("Verbose",false)}
+    , _bad_channel_files{pset.get<std::vector<std::string>>("BadChannelFiles", {})}
+    , _sce_grid_spacing{pset.get<double>("SCEGridSpacing", 5.0)}
     {
     }   
  
@@ -66,63 +73,118 @@ public:
     {
     }
 
+    // Share the run-level wire lookup table owned by the calling module
+    void setWireGeometry(const common::WireGeometryLUT* wire_lut)
+    {
+        _wire_lut = wire_lut;
+    }
+
+    // Share the space charge grid owned by the calling module
+    void setSCEGrid(const common::SCEGrid* sce_grid)
+    {
+        _sce_grid = sce_grid;
+    }
+
+    // Share the bad channel cache owned by the calling module, so that the static lists are read
+    // and the mask built once per job rather than once per tool
+    void setBadChannelCache(common::BadChannelCache* bad_channel_cache)
+    {
+        _bad_channel_cache = bad_channel_cache;
+    }
+
     std::map<common::PandoraView,std::vector<bool>> filter3Plane(const art::Event &e, const signature::Pattern& patt);
     std::vector<bool> filter(const art::Event &e, const signature::Pattern& patt, common::PandoraView view);
     virtual bool filter(const art::Event &e, const signature::Signature& sig, common::PandoraView view) = 0;
 
+    // Overloads that share a truth context the calling module built once for the event
+    std::vector<bool> filter(const art::Event &e, const signature::Pattern& patt, common::PandoraView view, const common::EventTruthContext& truth);
+    bool filter(const art::Event &e, const signature::Signature& sig, common::PandoraView view, const common::EventTruthContext& truth);
+
 private:
 
     const art::InputTag _HitProducer, _MCPproducer, _MCTproducer, _BacktrackTag, _DeadChannelTag;
 
 protected:
 
-    std::vector<bool> _bad_channel_mask;
+    const common::EventTruthContext* _truth = nullptr;
 
     const geo::GeometryCore* _geo = art::ServiceHandle<geo::Geometry>()->provider();
-     
+
+    const common::WireGeometryLUT& wireGeometry() const;
+    const common::SCEGrid& sceGrid() const;
+    std::shared_ptr<const common::BadChannelSet> badChannels(const art::Event &e);
+
+    // Points _truth at the context passed by the caller, or at one built by this tool and kept
+    // for the rest of the event when the caller did not pass one
     bool loadEventHandles(const art::Event &e, common::PandoraView targetDetectorPlane);
-    std::vector<art::Ptr<recob::Hit>> _evt_hits;
-    std::vector<art::Ptr<recob::Hit>> _mc_hits;
-    std::unique_ptr<art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>> _mcp_bkth_assoc;
+    const std::vector<bool>& badChannelMask() const { return _truth->badChannelMask(); }
+    const common::BadChannelIndex& badChannelIndex() const { return _truth->badChannelIndex(); }
 
     const bool _verbose;
 
+private:
+
+    const common::WireGeometryLUT* _wire_lut = nullptr;
+    mutable common::WireGeometryLUT _local_wire_lut;
+    const common::EventTruthContext* _shared_truth = nullptr;
+    common::EventTruthContext _local_truth;
+    const std::vector<std::string> _bad_channel_files;
+    common::BadChannelCache* _bad_channel_cache = nullptr;
+    std::unique_ptr<common::BadChannelCache> _local_bad_channel_cache;
+    const double _sce_grid_spacing;
+    const common::SCEGrid* _sce_grid = nullptr;
+    mutable common::SCEGrid _local_sce_grid;
+
 };
 
-bool ClarityToolBase::loadEventHandles(const art::Event &e, common::PandoraView targetDetectorPlane){
+const common::WireGeometryLUT& ClarityToolBase::wireGeometry() const {
+
+    if (_wire_lut != nullptr)
+        return *_wire_lut;
 
-    common::SetBadChannelMask(e,_DeadChannelTag,_bad_channel_mask);
+    if (_local_wire_lut.empty())
+        _local_wire_lut.build(_geo);
 
-    _evt_hits.clear();
-    _mc_hits.clear();
+    return _local_wire_lut;
 
-    art::Handle<std::vector<recob::Hit>> hit_h;
-    if (!e.getByLabel(_HitProducer, hit_h)) 
-        return false;
+}
 
-    art::fill_ptr_vector(_evt_hits, hit_h);
-    _mcp_bkth_assoc = std::make_unique<art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>>(hit_h, e, _BacktrackTag);
+const common::SCEGrid& ClarityToolBase::sceGrid() const {
+
+    if (_sce_grid != nullptr)
+        return *_sce_grid;
+
+    if (!_local_sce_grid.built())
+        _local_sce_grid.build(common::SCEGrid::Offsets::kSimSpatial, _sce_grid_spacing);
+
+    return _local_sce_grid;
+
+}
 
-    for (const auto& hit : _evt_hits) {
-        if (_bad_channel_mask[hit->Channel()]) 
-            continue; 
+std::shared_ptr<const common::BadChannelSet> ClarityToolBase::badChannels(const art::Event &e) {
 
-        const geo::WireID& wire_id = hit->WireID(); 
-        if (wire_id.Plane != static_cast<unsigned int>(targetDetectorPlane))
-            continue;
+    if (_bad_channel_cache != nullptr)
+        return _bad_channel_cache->get(e);
 
-        auto assmcp = _mcp_bkth_assoc->at(hit.key());
-        auto assmdt = _mcp_bkth_assoc->data(hit.key());
-        for (unsigned int ia = 0; ia < assmcp.size(); ++ia){
-            auto amd = assmdt[ia];
-            if (amd->isMaxIDEN != 1)
-                continue;
-            
-            _mc_hits.push_back(hit);
-        }
+    if (_local_bad_channel_cache == nullptr)
+        _local_bad_channel_cache = std::make_unique<common::BadChannelCache>(_DeadChannelTag, _bad_channel_files);
+
+    return _local_bad_channel_cache->get(e);
+
+}
+
+bool ClarityToolBase::loadEventHandles(const art::Event &e, common::PandoraView targetDetectorPlane){
+
+    if (_shared_truth != nullptr && _shared_truth->event == e.id()) {
+        _truth = _shared_truth;
+        return _truth->valid;
     }
 
-    return true;
+    if (!_local_truth.isFor(e))
+        common::BuildEventTruthContext(e,_HitProducer,_BacktrackTag,art::InputTag(),this->badChannels(e),true,_local_truth);
+
+    _truth = &_local_truth;
+    return _truth->valid;
 
 }
 
@@ -149,6 +211,27 @@ std::vector<bool> ClarityToolBase::filter(const art::Event &e, const signature::
 
 }
 
+std::vector<bool> ClarityToolBase::filter(const art::Event &e, const signature::Pattern& patt, common::PandoraView view, const common::EventTruthContext& truth){
+
+  std::vector<bool> result;
+  for (const auto& sig : patt) {
+    result.push_back(this->filter(e,sig,view,truth));
+  }
+
+  return result;
+
+}
+
+bool ClarityToolBase::filter(const art::Event &e, const signature::Signature& sig, common::PandoraView view, const common::EventTruthContext& truth){
+
+  _shared_truth = &truth;
+  bool result = this->filter(e,sig,view);
+  _shared_truth = nullptr;
+
+  return result;
+
+}
+
 }
 
 #endif
@@ -48,24 +48,15 @@ bool HitExclusivity::filter(const art::Event &e, const signature::Signature& sig
     double sig_q_inclusive = 0.0;
     double sig_q_exclusive = 0.0;
 
-    for (const auto& hit : _mc_hits) {
-      auto assmcp = _mcp_bkth_assoc->at(hit.key());
-      auto assmdt = _mcp_bkth_assoc->data(hit.key());
-
-      for (unsigned int ia = 0; ia < assmcp.size(); ++ia){
-        auto amd = assmdt[ia];
-        if (assmcp[ia]->TrackId() == mcp_s->TrackId()) {
-          sig_q_inclusive += amd->numElectrons * amd->ideNFraction;
-
-          // Calculate the fraction of energy due to delta rays
-          double e_frac = 0.0;
-          for (unsigned int ia2 = 0; ia2 < assmcp.size(); ++ia2){
-            if(abs(assmcp[ia2]->PdgCode()) == 11 && assmcp[ia2]->Process() != "primary") e_frac += assmdt[ia2]->ideNFraction;
-          }          
-          if (amd->ideNFraction/(1.0 - e_frac) > _hit_exclus_thresh){
-            sig_q_exclusive += amd->numElectrons * amd->ideNFraction;
-          }
-        }
+    const auto& delta_ray_fraction = _truth->delta_ray_fraction[view];
+    for (const auto& match : _truth->matches(view, mcp_s->TrackId())) {
+      auto amd = match.data;
+      sig_q_inclusive += amd->numElectrons * amd->ideNFraction;
+
+      // Fraction of the hit's energy due to delta rays
+      const double e_frac = delta_ray_fraction[match.hit];
+      if (amd->ideNFraction/(1.0 - e_frac) > _hit_exclus_thresh){
+        sig_q_exclusive += amd->numElectrons * amd->ideNFraction;
       }
     }
   
@@ -47,20 +47,14 @@ bool PatternCompleteness::filter(const art::Event &e, const signature::Signature
     std::unordered_map<int, int> sig_hit_map;
     double tot_sig_hit = 0; 
 
-    std::vector<art::Ptr<recob::Hit>> sig_hits;
+    size_t n_sig_hits = 0;
     for (const auto& mcp_s : sig.second) {
       double sig_hit = 0;
 
-      for (const auto& hit : _mc_hits) {
-        auto assmcp = _mcp_bkth_assoc->at(hit.key());
-        auto assmdt = _mcp_bkth_assoc->data(hit.key());
-
-        for (unsigned int ia = 0; ia < assmcp.size(); ++ia){
-          auto amd = assmdt[ia];
-          if (assmcp[ia]->TrackId() == mcp_s->TrackId() && amd->isMaxIDEN == 1) {
-            sig_hits.push_back(hit);
-            sig_hit += 1; 
-          }
+      for (const auto& match : _truth->matches(view, mcp_s->TrackId())) {
+        if (match.data->isMaxIDEN == 1) {
+          n_sig_hits++;
+          sig_hit += 1; 
         }
       }
 
@@ -70,7 +64,7 @@ bool PatternCompleteness::filter(const art::Event &e, const signature::Signature
         std::cout << "Particle pdg=" << mcp_s->PdgCode() << " trackid=" << mcp_s->TrackId() << " hits = " << sig_hit << std::endl;
     }
 
-    if (_mc_hits.empty() || sig_hits.empty()) 
+    if (_truth->mc_hits[view].empty() || n_sig_hits == 0) 
         return false;
 
     for (const auto& [trackid, num_hits] : sig_hit_map) 
@@ -43,32 +43,19 @@ protected:
    bool checkEnd(const art::Ptr<simb::MCParticle>& part, const common::PandoraView view) const; 
    bool checkEnd2(const art::Ptr<simb::MCParticle>& part, const common::PandoraView view) const; 
    bool checkDeadChannelFrac(const art::Ptr<simb::MCParticle>& part, const common::PandoraView view) const;
+   void getScanPoints(const art::Ptr<simb::MCParticle>& part, bool from_end, std::vector<float>& x, std::vector<float>& y, std::vector<float>& z) const;
 
 };
 
 bool SignatureIntegrity::isChannelRegionActive(const TVector3& point, const common::PandoraView& view, int act_reg) const
 {
-  for (geo::PlaneID const& plane : _geo->IteratePlaneIDs()) {
-    if(static_cast<unsigned int>(plane.Plane) != static_cast<unsigned int>(view)) continue;
-    try {
-      geo::WireID wire = _geo->NearestWireID(point, plane);
-      raw::ChannelID_t central_channel = _geo->PlaneWireToChannel(wire);
+  const common::WireGeometryLUT& wire_lut = this->wireGeometry();
 
-      for (int offset = -act_reg; offset <= act_reg; ++offset) {
-        raw::ChannelID_t neighboring_channel = central_channel + offset;
-        if (neighboring_channel < 0 || static_cast<size_t>(neighboring_channel) >= _geo->Nchannels())
-          continue; 
+  int central_channel = wire_lut.nearestChannel(point, static_cast<unsigned int>(view));
+  if (central_channel < 0)
+    return false;
 
-        if (_bad_channel_mask[neighboring_channel]){
-          return false; 
-        }
-
-      }
-    } catch (const cet::exception&) {
-      return false; 
-    }
-  }
-  return true;
+  return this->badChannelIndex().isRegionActive(central_channel, act_reg);
 }
 
 bool SignatureIntegrity::checkStart(const art::Ptr<simb::MCParticle>& part, const common::PandoraView view) const
@@ -76,7 +63,7 @@ bool SignatureIntegrity::checkStart(const art::Ptr<simb::MCParticle>& part, cons
     float x = part->Vx();
     float y = part->Vy();
     float z = part->Vz();
-    common::ApplySCEMappingXYZ(x,y,z);
+    this->sceGrid().map(x,y,z);
     bool pass = isChannelRegionActive(TVector3(x,y,z),view,_chan_act_reg);
 
     if(_verbose){
@@ -92,19 +79,12 @@ bool SignatureIntegrity::checkStart(const art::Ptr<simb::MCParticle>& part, cons
 bool SignatureIntegrity::checkStart2(const art::Ptr<simb::MCParticle>& part, const common::PandoraView view) const
 {
 
-    TVector3 start(part->Vx(),part->Vy(),part->Vz());
-
-    for(int i_p=0;i_p<=part->NumberTrajectoryPoints();i_p++){
+    std::vector<float> x, y, z;
+    this->getScanPoints(part, false, x, y, z);
 
-      float x = part->Vx(i_p);
-      float y = part->Vy(i_p);
-      float z = part->Vz(i_p);
+    for(size_t i_p=0;i_p<x.size();i_p++){
 
-      double dist = (TVector3(x,y,z) - start).Mag(); 
-      if(dist > _dist_to_scan) break;
-
-      common::ApplySCEMappingXYZ(x,y,z);
-      bool pass = isChannelRegionActive(TVector3(x,y,z),view,0);
+      bool pass = isChannelRegionActive(TVector3(x[i_p],y[i_p],z[i_p]),view,0);
 
       if(_verbose && !pass){
         std::cout << "Track start bad" << std::endl;
@@ -123,7 +103,7 @@ bool SignatureIntegrity::checkEnd(const art::Ptr<simb::MCParticle>& part, const
     float x = part->EndX();
     float y = part->EndY();
     float z = part->EndZ();
-    common::ApplySCEMappingXYZ(x,y,z);    
+    this->sceGrid().map(x,y,z);
     bool pass = isChannelRegionActive(TVector3(x,y,z),view,_chan_act_reg);
 
     if(_verbose){
@@ -137,19 +117,12 @@ bool SignatureIntegrity::checkEnd(const art::Ptr<simb::MCParticle>& part, const
 bool SignatureIntegrity::checkEnd2(const art::Ptr<simb::MCParticle>& part, const common::PandoraView view) const
 {
 
-    TVector3 end(part->EndX(),part->EndY(),part->EndZ());
-
-    for(int i_p=part->NumberTrajectoryPoints();i_p>=0;i_p--){
+    std::vector<float> x, y, z;
+    this->getScanPoints(part, true, x, y, z);
 
-      float x = part->Vx(i_p);
-      float y = part->Vy(i_p);
-      float z = part->Vz(i_p);
+    for(size_t i_p=0;i_p<x.size();i_p++){
 
-      double dist = (TVector3(x,y,z) - end).Mag(); 
-      if(dist > _dist_to_scan) break;
-
-      common::ApplySCEMappingXYZ(x,y,z);
-      bool pass = isChannelRegionActive(TVector3(x,y,z),view,0);
+      bool pass = isChannelRegionActive(TVector3(x[i_p],y[i_p],z[i_p]),view,0);
 
       if(_verbose && !pass){
         std::cout << "Track end bad" << std::endl;
@@ -163,6 +136,32 @@ bool SignatureIntegrity::checkEnd2(const art::Ptr<simb::MCParticle>& part, const
     return true;  
 }
 
+// Trajectory points within _dist_to_scan of the start (or end) of the particle, walking inwards,
+// mapped to their space charge displaced positions in one batch
+void SignatureIntegrity::getScanPoints(const art::Ptr<simb::MCParticle>& part, bool from_end, std::vector<float>& x, std::vector<float>& y, std::vector<float>& z) const
+{
+
+    const int n_points = part->NumberTrajectoryPoints();
+    if(n_points == 0) return;
+
+    const int first = from_end ? n_points - 1 : 0;
+    const int step = from_end ? -1 : 1;
+    const TVector3 origin(part->Vx(first),part->Vy(first),part->Vz(first));
+
+    for(int i_p=first;i_p>=0 && i_p<n_points;i_p+=step){
+
+      const TVector3 point(part->Vx(i_p),part->Vy(i_p),part->Vz(i_p));
+      if((point - origin).Mag() > _dist_to_scan) break;
+
+      x.push_back(point.X());
+      y.push_back(point.Y());
+      z.push_back(point.Z());
+
+    }
+
+    this->sceGrid().map(x.size(),x.data(),y.data(),z.data());
+
+}
 
 // Check how many dead channels lie between the start and end of the track
 bool SignatureIntegrity::checkDeadChannelFrac(const art::Ptr<simb::MCParticle>& part, const common::PandoraView view) const
@@ -171,51 +170,39 @@ bool SignatureIntegrity::checkDeadChannelFrac(const art::Ptr<simb::MCParticle>&
   float startx = part->Vx();
   float starty = part->Vy();
   float startz = part->Vz();
-  common::ApplySCEMappingXYZ(startx,starty,startz);    
+  this->sceGrid().map(startx,starty,startz);
   float endx = part->EndX();
   float endy = part->EndY();
   float endz = part->EndZ();
-  common::ApplySCEMappingXYZ(endx,endy,endz);    
-
-  for (geo::PlaneID const& plane : _geo->IteratePlaneIDs()) {
-    if(static_cast<unsigned int>(plane.Plane) != static_cast<unsigned int>(view)) continue;
-    try {
-      geo::WireID start_wire = _geo->NearestWireID(TVector3(startx,starty,startz), plane);
-      raw::ChannelID_t start_channel = _geo->PlaneWireToChannel(start_wire);
-      geo::WireID end_wire = _geo->NearestWireID(TVector3(endx,endy,endz), plane);
-      raw::ChannelID_t end_channel = _geo->PlaneWireToChannel(end_wire);
-      double channels = abs(static_cast<int>(start_channel) - static_cast<int>(end_channel));
-      double bad_channels = 0;
-      int cons_bad_ch = 0;
-      int last_bad_ch = -1000;
-      for(int ch=std::min(start_channel,end_channel);ch<=std::max(start_channel,end_channel);ch++){
-        if(_bad_channel_mask[ch]){
-          bad_channels++;
-          if(last_bad_ch == ch - 1) cons_bad_ch++;
-          else cons_bad_ch = 1; 
-          last_bad_ch = ch;
-          if(cons_bad_ch > _max_consecutive_bad_channel){
-            if(_verbose)
-              std::cout << "Tool many consecutive dead channels" << std::endl;
-            return false; 
-          }
-        }
-      }
+  this->sceGrid().map(endx,endy,endz);
 
-      if(_verbose){
-        std::cout << "Bad channels = " << bad_channels << std::endl;
-        std::cout << "Bad channel fraction = " << bad_channels/channels << std::endl;
-      }
+  const common::WireGeometryLUT& wire_lut = this->wireGeometry();
 
-      if(bad_channels/channels > _max_bad_channel_frac){
-        if(_verbose) 
-          std::cout << "Failed bad channel fraction" << std::endl;
-        return false; 
-      }
-    }
-    catch (const cet::exception&) {
-      return false; 
-    }
+  int start_channel = wire_lut.nearestChannel(starty, startz, static_cast<unsigned int>(view));
+  int end_channel = wire_lut.nearestChannel(endy, endz, static_cast<unsigned int>(view));
+  if (start_channel < 0 || end_channel < 0)
+    return false;
+
+  const common::BadChannelIndex& bad_channel_index = this->badChannelIndex();
+
+  double channels = abs(static_cast<int>(start_channel) - static_cast<int>(end_channel));
+  if(bad_channel_index.longestRun(start_channel,end_channel) > _max_consecutive_bad_channel){
+    if(_verbose)
+      std::cout << "Tool many consecutive dead channels" << std::endl;
+    return false; 
+  }
+
+  double bad_channels = bad_channel_index.nBad(start_channel,end_channel);
+
+  if(_verbose){
+    std::cout << "Bad channels = " << bad_channels << std::endl;
+    std::cout << "Bad channel fraction = " << bad_channels/channels << std::endl;
+  }
+
+  if(bad_channels/channels > _max_bad_channel_frac){
+    if(_verbose) 
+      std::cout << "Failed bad channel fraction" << std::endl;
+    return false; 
   }
 
   return true;
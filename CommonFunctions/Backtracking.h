@@ -14,6 +14,11 @@
 
 #include "lardata/Utilities/FindManyInChainP.h"
 
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <numeric>
+
 namespace common
 {
     void ApplyDetectorOffsets(const float _vtx_t, const float _vtx_x, const float _vtx_y, const float _vtx_z, float &_xtimeoffset, float &_xsceoffset, float &_ysceoffset, float &_zsceoffset)
@@ -123,10 +128,77 @@ namespace common
         float start_x, start_y, start_z, start_t;
     };
 
+    // TrackId to BtPart lookup, built once alongside the BtPart vector so that matching a hit costs
+    // one hash probe rather than a search through the TrackIds of every BtPart. A TrackId held by
+    // several BtParts resolves to each of them once, in BtPart order
+    class BtPartIndex
+    {
+    public:
+        BtPartIndex() = default;
+        explicit BtPartIndex(const std::vector<BtPart> &btparts) { this->build(btparts); }
+
+        void build(const std::vector<BtPart> &btparts)
+        {
+            _head.clear();
+            _entries.clear();
+            for (int ib = static_cast<int>(btparts.size()) - 1; ib >= 0; --ib)
+            {
+                for (const unsigned int tid : btparts[ib].tids)
+                {
+                    auto it = _head.emplace(tid, -1).first;
+                    if (it->second != -1 && _entries[it->second].btpart == ib)
+                        continue;
+
+                    _entries.push_back({ib, it->second});
+                    it->second = _entries.size() - 1;
+                }
+            }
+        }
+
+        template <typename Function>
+        void forEach(const unsigned int tid, Function &&function) const
+        {
+            const auto it = _head.find(tid);
+            if (it == _head.end())
+                return;
+
+            for (int e = it->second; e != -1; e = _entries[e].next)
+                function(_entries[e].btpart);
+        }
+
+    private:
+        struct Entry
+        {
+            int btpart;
+            int next;
+        };
+
+        std::unordered_map<unsigned int, int> _head;
+        std::vector<Entry> _entries;
+    };
+
+    // Adds one count per BtPart holding the TrackId of a max-IDE MCParticle of the hit
+    void countBtPartHits(const size_t hit_key,
+                        const std::unique_ptr<art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>> &assocMCPart,
+                        const BtPartIndex &btindex,
+                        std::vector<unsigned int> &bthitsv)
+    {
+        const auto &assmcp = assocMCPart->at(hit_key);
+        const auto &assmdt = assocMCPart->data(hit_key);
+        for (unsigned int ia = 0; ia < assmcp.size(); ++ia)
+        {
+            if (assmdt[ia]->isMaxIDE != 1)
+                continue;
+
+            btindex.forEach(assmcp[ia]->TrackId(), [&bthitsv](const int ib) { bthitsv[ib]++; });
+        }
+    }
+
     std::vector<BtPart> initBacktrackingParticleVec(const std::vector<sim::MCShower> &inputMCShower,
                                                     const std::vector<sim::MCTrack> &inputMCTrack,
                                                     const std::vector<recob::Hit> &inputHits,
-                                                    const std::unique_ptr<art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>> &assocMCPart)
+                                                    const std::unique_ptr<art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>> &assocMCPart,
+                                                    BtPartIndex &btindex)
     {
         std::vector<BtPart> btparts_v;
         for (auto mcs : inputMCShower)
@@ -150,121 +222,113 @@ namespace common
             }
         }
 
+        btindex.build(btparts_v);
+
+        std::vector<unsigned int> bthitsv(btparts_v.size(), 0);
         for (unsigned int ih = 0; ih < inputHits.size(); ih++)
+            countBtPartHits(ih, assocMCPart, btindex, bthitsv);
+
+        for (size_t ib = 0; ib < btparts_v.size(); ++ib)
+            btparts_v[ib].nhits += bthitsv[ib];
+
+        return btparts_v;
+    }
+
+    std::vector<BtPart> initBacktrackingParticleVec(const std::vector<sim::MCShower> &inputMCShower,
+                                                    const std::vector<sim::MCTrack> &inputMCTrack,
+                                                    const std::vector<recob::Hit> &inputHits,
+                                                    const std::unique_ptr<art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>> &assocMCPart)
+    {
+        BtPartIndex btindex;
+        return initBacktrackingParticleVec(inputMCShower, inputMCTrack, inputHits, assocMCPart, btindex);
+    }
+
+    // Best BtPart of a set of hits, the one backtracked to the most of them, with the fraction of
+    // the hits it holds (purity), the fraction of its hits in the set (completeness) and the fraction
+    // of the hits matching no BtPart (overlay purity). The hit count of every BtPart is kept in bthits
+    struct BtPartMatch
+    {
+        int btpart = -1;
+        float purity = 0.;
+        float completeness = 0.;
+        float overlay_purity = 0.;
+        std::vector<unsigned int> bthits;
+    };
+
+    void fillBtPartMatch(const size_t n_hits, const std::vector<BtPart> &btpartsv, BtPartMatch &match)
+    {
+        const auto &bthitsv = match.bthits;
+        unsigned int maxel = (std::max_element(bthitsv.begin(), bthitsv.end()) - bthitsv.begin());
+        if (maxel == bthitsv.size() || bthitsv[maxel] == 0)
+            return;
+
+        match.btpart = maxel;
+        match.purity = float(bthitsv[maxel]) / float(n_hits);
+        match.completeness = float(bthitsv[maxel]) / float(btpartsv[maxel].nhits);
+        match.overlay_purity = 1. - std::accumulate(bthitsv.begin(), bthitsv.end(), 0.) / float(n_hits);
+    }
+
+    // Matches every PFParticle of a slice, given as its hits, to the BtParts in a single pass over the hits
+    std::vector<BtPartMatch> getAssocBtParts(const std::vector<std::vector<art::Ptr<recob::Hit>>> &pfp_hits_v,
+                                            const std::unique_ptr<art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>> &assocMCPart,
+                                            const std::vector<BtPart> &btpartsv,
+                                            const BtPartIndex &btindex)
+    {
+        std::vector<BtPartMatch> matches(pfp_hits_v.size());
+        for (size_t ip = 0; ip < pfp_hits_v.size(); ++ip)
         {
-            auto assmcp = assocMCPart->at(ih);
-            auto assmdt = assocMCPart->data(ih);
-            for (unsigned int ia = 0; ia < assmcp.size(); ++ia)
-            {
-                auto mcp = assmcp[ia];
-                auto amd = assmdt[ia];
-                if (amd->isMaxIDE != 1)
-                    continue;
-                for (auto &btp : btparts_v)
-                {
-                    if (std::find(btp.tids.begin(), btp.tids.end(), mcp->TrackId()) != btp.tids.end())
-                    {
-                        btp.nhits++;
-                    }
-                } 
-            }
+            BtPartMatch &match = matches[ip];
+            match.bthits.assign(btpartsv.size(), 0);
+            for (const art::Ptr<recob::Hit> &hitp : pfp_hits_v[ip])
+                countBtPartHits(hitp.key(), assocMCPart, btindex, match.bthits);
+
+            fillBtPartMatch(pfp_hits_v[ip].size(), btpartsv, match);
         }
 
-        return btparts_v;
+        return matches;
     }
 
     int getAssocBtPart(const std::vector<art::Ptr<recob::Hit>> &hits,
                     const std::unique_ptr<art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>> &assocMCPart,
                     const std::vector<BtPart> &btpartsv,
+                    const BtPartIndex &btindex,
                     float &purity,
                     float &completeness,
                     float &overlay_purity)
     {
-        std::vector<unsigned int> bthitsv(btpartsv.size(), 0);
-        
-        for (unsigned int ih = 0; ih < hits.size(); ih++)
-        {
-            art::Ptr<recob::Hit> hitp = hits[ih];
-            auto assmcp = assocMCPart->at(hitp.key());
-            auto assmdt = assocMCPart->data(hitp.key());
-            for (unsigned int ia = 0; ia < assmcp.size(); ++ia)
-            {
-                auto mcp = assmcp[ia];
-                auto amd = assmdt[ia];
-                if (amd->isMaxIDE != 1)
-                    continue;
-                for (unsigned int ib = 0; ib < btpartsv.size(); ++ib)
-                {
-                    auto &btp = btpartsv[ib];
-                    if (std::find(btp.tids.begin(), btp.tids.end(), mcp->TrackId()) != btp.tids.end())
-                    {
-                        bthitsv[ib]++;
-                    }
-                }
-            }
-        }
+        BtPartMatch match;
+        match.bthits.assign(btpartsv.size(), 0);
+        for (const art::Ptr<recob::Hit> &hitp : hits)
+            countBtPartHits(hitp.key(), assocMCPart, btindex, match.bthits);
 
-        purity = 0.;
-        completeness = 0.;
-        unsigned int maxel = (std::max_element(bthitsv.begin(), bthitsv.end()) - bthitsv.begin());
-        if (maxel == bthitsv.size())
-            return -1;
+        fillBtPartMatch(hits.size(), btpartsv, match);
 
-        if (bthitsv[maxel] == 0)
-            return -1;
-        
-        purity = float(bthitsv[maxel]) / float(hits.size());
-        completeness = float(bthitsv[maxel]) / float(btpartsv[maxel].nhits);
-        overlay_purity = 1. - std::accumulate(bthitsv.begin(), bthitsv.end(), 0.) / float(hits.size());
-        
-        return maxel;
+        purity = match.purity;
+        completeness = match.completeness;
+        if (match.btpart != -1)
+            overlay_purity = match.overlay_purity;
+
+        return match.btpart;
     }
 
     int getAssocBtPart(const std::vector<art::Ptr<recob::Hit>> &hits,
                     const std::unique_ptr<art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>> &assocMCPart,
                     const std::vector<BtPart> &btpartsv,
                     float &purity,
-                    float &completeness)
+                    float &completeness,
+                    float &overlay_purity)
     {
-        std::vector<unsigned int> bthitsv(btpartsv.size(), 0);
-
-        for (unsigned int ih = 0; ih < hits.size(); ih++)
-        {
-            art::Ptr<recob::Hit> hitp = hits[ih];
-            auto assmcp = assocMCPart->at(hitp.key());
-            auto assmdt = assocMCPart->data(hitp.key());
-            for (unsigned int ia = 0; ia < assmcp.size(); ++ia)
-            {
-                auto mcp = assmcp[ia];
-                auto amd = assmdt[ia];
-                if (amd->isMaxIDE != 1)
-                    continue;
-
-                for (unsigned int ib = 0; ib < btpartsv.size(); ++ib)
-                {
-                    auto &btp = btpartsv[ib];
-                    if (std::find(btp.tids.begin(), btp.tids.end(), mcp->TrackId()) != btp.tids.end())
-                    {
-                        bthitsv[ib]++;
-                    }
-                }
-            }
-        }
-
-        purity = 0.;
-        completeness = 0.;
-        unsigned int maxel = (std::max_element(bthitsv.begin(), bthitsv.end()) - bthitsv.begin());
-
-        if (maxel == bthitsv.size())
-            return -1;
+        return getAssocBtPart(hits, assocMCPart, btpartsv, BtPartIndex(btpartsv), purity, completeness, overlay_purity);
+    }
 
-        if (bthitsv[maxel] == 0)
-            return -1;
-    
-        purity = float(bthitsv[maxel]) / float(hits.size());
-        completeness = float(bthitsv[maxel]) / float(btpartsv[maxel].nhits);
-    
-        return maxel;
+    int getAssocBtPart(const std::vector<art::Ptr<recob::Hit>> &hits,
+                    const std::unique_ptr<art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>> &assocMCPart,
+                    const std::vector<BtPart> &btpartsv,
+                    float &purity,
+                    float &completeness)
+    {
+        float overlay_purity = 0.;
+        return getAssocBtPart(hits, assocMCPart, btpartsv, BtPartIndex(btpartsv), purity, completeness, overlay_purity);
     }
 
     bool isHitBtMonteCarlo(const size_t hit_index,
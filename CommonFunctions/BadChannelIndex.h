@@ -0,0 +1,144 @@
+#ifndef BADCHANNELINDEX_H
+#define BADCHANNELINDEX_H
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+#include <cstddef>
+
+namespace common
+{
+    // Constant-time queries over a bad channel mask. Built once from the mask, it holds prefix
+    // counts of dead channels, a sparse table over the length of the dead run ending at each
+    // channel and, per channel, the next live channel and the distance to the nearest dead one.
+    // Channels outside the mask are treated as live
+    class BadChannelIndex
+    {
+    public:
+        static constexpr int kNoBadChannel = std::numeric_limits<int>::max();
+
+        void build(const std::vector<bool>& mask)
+        {
+            const size_t n = mask.size();
+            _n = n;
+
+            _prefix.assign(n + 1, 0);
+            for (size_t ch = 0; ch < n; ++ch)
+                _prefix[ch + 1] = _prefix[ch] + (mask[ch] ? 1 : 0);
+
+            _next_live.assign(n + 1, n);
+            for (size_t ch = n; ch-- > 0;)
+                _next_live[ch] = mask[ch] ? _next_live[ch + 1] : ch;
+
+            _distance.assign(n, kNoBadChannel);
+            int last = -1;
+            for (size_t ch = 0; ch < n; ++ch)
+            {
+                if (mask[ch])
+                    last = ch;
+                if (last >= 0)
+                    _distance[ch] = ch - last;
+            }
+            last = -1;
+            for (size_t ch = n; ch-- > 0;)
+            {
+                if (mask[ch])
+                    last = ch;
+                if (last >= 0)
+                    _distance[ch] = std::min(_distance[ch], static_cast<int>(last - ch));
+            }
+
+            _log2.assign(n + 1, 0);
+            for (size_t len = 2; len <= n; ++len)
+                _log2[len] = _log2[len / 2] + 1;
+            _levels = n > 0 ? _log2[n] + 1 : 0;
+
+            _run_table.assign(_levels * n, 0);
+            for (size_t ch = 0; ch < n; ++ch)
+                _run_table[ch] = mask[ch] ? (ch > 0 ? _run_table[ch - 1] + 1 : 1) : 0;
+
+            for (size_t k = 1; k < _levels; ++k)
+            {
+                const size_t half = size_t(1) << (k - 1);
+                const int32_t* prev = &_run_table[(k - 1) * n];
+                int32_t* curr = &_run_table[k * n];
+                for (size_t ch = 0; ch + (size_t(1) << k) <= n; ++ch)
+                    curr[ch] = std::max(prev[ch], prev[ch + half]);
+            }
+        }
+
+        size_t size() const { return _n; }
+
+        bool isBad(const int ch) const
+        {
+            return ch >= 0 && static_cast<size_t>(ch) < _n && _prefix[ch + 1] != _prefix[ch];
+        }
+
+        // Number of dead channels in [lo, hi]
+        int nBad(int lo, int hi) const
+        {
+            if (!this->clip(lo, hi))
+                return 0;
+
+            return _prefix[hi + 1] - _prefix[lo];
+        }
+
+        // Length of the longest run of consecutive dead channels inside [lo, hi]
+        int longestRun(int lo, int hi) const
+        {
+            if (!this->clip(lo, hi))
+                return 0;
+
+            // A run crossing lo is clipped there, every later run starts inside the range
+            const size_t live = _next_live[lo];
+            if (live > static_cast<size_t>(hi))
+                return hi - lo + 1;
+
+            return std::max(static_cast<int>(live) - lo, this->maxRunEnd(live, hi));
+        }
+
+        // Distance in channel number to the nearest dead channel, kNoBadChannel if there is none
+        int distanceToBad(const int ch) const
+        {
+            if (ch < 0 || static_cast<size_t>(ch) >= _n)
+                return kNoBadChannel;
+
+            return _distance[ch];
+        }
+
+        // True if no channel within act_reg of ch is dead
+        bool isRegionActive(const int ch, const int act_reg) const
+        {
+            return this->distanceToBad(ch) > act_reg;
+        }
+
+    private:
+        bool clip(int& lo, int& hi) const
+        {
+            if (lo > hi)
+                std::swap(lo, hi);
+
+            lo = std::max(lo, 0);
+            hi = std::min<long>(hi, static_cast<long>(_n) - 1);
+            return lo <= hi;
+        }
+
+        int maxRunEnd(const size_t lo, const size_t hi) const
+        {
+            const size_t k = _log2[hi - lo + 1];
+            const int32_t* level = &_run_table[k * _n];
+            return std::max(level[lo], level[hi + 1 - (size_t(1) << k)]);
+        }
+
+        size_t _n = 0;
+        size_t _levels = 0;
+        std::vector<int32_t> _prefix;
+        std::vector<size_t> _next_live;
+        std::vector<int> _distance;
+        std::vector<int32_t> _run_table;
+        std::vector<uint8_t> _log2;
+    };
+}
+
+#endif
@@ -22,6 +22,7 @@
 #include "CommonFunctions/Corrections.h"
 #include "CommonFunctions/Region.h"
 #include "CommonFunctions/Types.h"
+#include "CommonFunctions/BadChannelIndex.h"
 
 #include "art/Utilities/ToolMacros.h"
 #include "art/Utilities/make_tool.h"
@@ -34,6 +35,10 @@
 
 #include "TDatabasePDG.h"
 
+#include "cetlib/search_path.h"
+#include "canvas/Persistency/Provenance/ProductID.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
 #include <string>
 #include <vector>
 #include <map>
@@ -42,6 +47,10 @@
 #include <unordered_map>
 #include <cmath>
 #include <chrono>
+#include <memory>
+#include <sstream>
+#include <algorithm>
+#include <cstdint>
 
 namespace common {
 
@@ -54,7 +63,7 @@ void SetBadChannelMask(const art::Event& e, const art::InputTag& bad_channel_tag
 
   size_t num_channels = geo->Nchannels();
   //std::cout << "num_channels = " <<  num_channels << std::endl;
-  bad_channel_mask.resize(num_channels, false);
+  bad_channel_mask.assign(num_channels, false);
 
   art::Handle<std::vector<int>> bad_ch_h;
   std::vector<art::Ptr<int>> bad_ch_v;
@@ -71,5 +80,129 @@ void SetBadChannelMask(const art::Event& e, const art::InputTag& bad_channel_tag
 
 }
 
+// Reads a static dead channel list: one channel or an inclusive "first last" range per line,
+// with lines starting with '#' ignored. The file is looked up as given, then on FW_SEARCH_PATH
+void ReadBadChannelFile(const std::string& file_name, std::vector<int>& channels)
+{
+
+  std::string path = file_name;
+  if (!std::ifstream(path).good()) {
+    cet::search_path sp("FW_SEARCH_PATH");
+    if (!sp.find_file(file_name, path))
+      throw cet::exception("ReadBadChannelFile:") << "Bad channel file " << file_name << " not found" << std::endl;
+  }
+
+  std::ifstream in(path);
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    std::istringstream ss(line);
+    int first, last;
+    if (!(ss >> first))
+      continue;
+    if (!(ss >> last))
+      last = first;
+
+    for (int ch = first; ch <= last; ++ch)
+      channels.push_back(ch);
+  }
+
+}
+
+// Dead channels of one version of the bad channel product, merged with the static lists
+struct BadChannelSet
+{
+  art::ProductID product;
+  uint64_t hash = 0;
+  std::vector<bool> mask;
+  BadChannelIndex index;
+};
+
+// Per-job cache of the bad channel mask. The product is hashed every event, but the mask and
+// its index are rebuilt only when the product ID or the hash changes, and handed out read-only
+// so that the module and the tools it passes them to share one copy
+class BadChannelCache
+{
+
+public:
+
+  BadChannelCache(const art::InputTag& bad_channel_tag, const std::vector<std::string>& static_files = {})
+    : _bad_channel_tag{bad_channel_tag}
+  {
+    for (const auto& file_name : static_files)
+      ReadBadChannelFile(file_name, _static_channels);
+
+    std::sort(_static_channels.begin(), _static_channels.end());
+    _static_channels.erase(std::unique(_static_channels.begin(), _static_channels.end()), _static_channels.end());
+  }
+
+  std::shared_ptr<const BadChannelSet> get(const art::Event& e)
+  {
+    art::Handle<std::vector<int>> bad_ch_h;
+    if(!e.getByLabel(_bad_channel_tag,bad_ch_h))
+      throw cet::exception("BadChannelCache:") << "Bad channel product with tag" << _bad_channel_tag << " not found" << std::endl;
+
+    // FNV-1a over the channel list
+    uint64_t hash = 14695981039346656037ULL;
+    for (const int ch : *bad_ch_h) {
+      const uint32_t v = static_cast<uint32_t>(ch);
+      for (int b = 0; b < 4; ++b) {
+        hash ^= (v >> (8 * b)) & 0xff;
+        hash *= 1099511628211ULL;
+      }
+    }
+
+    if (_current != nullptr && _current->product == bad_ch_h.id() && _current->hash == hash)
+      return _current;
+
+    const geo::GeometryCore* geo = art::ServiceHandle<geo::Geometry>()->provider();
+
+    auto bad_channels = std::make_shared<BadChannelSet>();
+    bad_channels->product = bad_ch_h.id();
+    bad_channels->hash = hash;
+    bad_channels->mask.assign(geo->Nchannels(), false);
+
+    // Channels the geometry does not have are dropped rather than masked, as a list written for
+    // another detector configuration would otherwise abort the job
+    const int n_channels = bad_channels->mask.size();
+    size_t n_dropped = 0;
+    for (const std::vector<int>* channels : {&_static_channels, bad_ch_h.product()}) {
+      for (const int ch : *channels) {
+        if (ch < 0 || ch >= n_channels) {
+          ++n_dropped;
+          continue;
+        }
+        bad_channels->mask[ch] = true;
+      }
+    }
+
+    if (n_dropped > 0)
+      mf::LogWarning("BadChannelCache") << "Dropped " << n_dropped << " bad channels outside the "
+                                        << n_channels << " channels of the geometry";
+
+    bad_channels->index.build(bad_channels->mask);
+    _current = bad_channels;
+    ++_n_builds;
+
+    mf::LogInfo("BadChannelCache") << "Rebuilt bad channel mask from " << _bad_channel_tag.encode() << ": "
+                                   << bad_ch_h->size() << " channels from the product, " << _static_channels.size()
+                                   << " from static lists, " << bad_channels->index.nBad(0, bad_channels->mask.size() - 1) << " in total";
+
+    return _current;
+  }
+
+  size_t nBuilds() const { return _n_builds; }
+
+private:
+
+  const art::InputTag _bad_channel_tag;
+  std::vector<int> _static_channels;
+  std::shared_ptr<const BadChannelSet> _current;
+  size_t _n_builds = 0;
+
+};
+
 }
 #endif
@@ -0,0 +1,231 @@
+#ifndef EVENTTRUTHCONTEXT_H
+#define EVENTTRUTHCONTEXT_H
+
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Handle.h"
+#include "canvas/Persistency/Common/FindManyP.h"
+#include "canvas/Persistency/Provenance/EventID.h"
+#include "canvas/Persistency/Provenance/ProductID.h"
+#include "canvas/Utilities/InputTag.h"
+
+#include "lardataobj/AnalysisBase/BackTrackerMatchingData.h"
+#include "lardataobj/RecoBase/Hit.h"
+#include "nusimdata/SimulationBase/MCParticle.h"
+
+#include "CommonFunctions/Pandora.h"
+#include "CommonFunctions/BadChannels.h"
+#include "CommonFunctions/Processes.h"
+#include "CommonFunctions/HitTruthOwners.h"
+
+#include <vector>
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include <cstdlib>
+#include <cstdint>
+
+namespace common
+{
+    // One backtracker association of a truth-matched hit: the index of the hit in its plane's
+    // mc_hits list and the matching data of the association
+    struct TruthHitMatch
+    {
+        uint32_t hit;
+        const anab::BackTrackerHitMatchingData* data;
+    };
+
+    // Truth matching of the hit collection, built once per event and shared by every consumer.
+    // owners holds the max-IDE owner of every hit. Per plane, mc_hits holds each good-channel hit
+    // once for every max-IDE (isMaxIDEN) association, aligned with the particle of that association
+    // and the fraction of the hit's charge from non-primary electrons. track_hits inverts all
+    // associations of those entries by TrackId, so the hits of one particle are found without
+    // scanning the event
+    struct EventTruthContext
+    {
+        art::EventID event;
+        bool valid = false;
+
+        art::ProductID hit_product;
+        std::vector<art::Ptr<recob::Hit>> hits;
+        HitTruthOwners owners;
+        std::unique_ptr<art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>> assoc;
+        std::shared_ptr<const BadChannelSet> bad_channels;
+
+        std::array<std::vector<art::Ptr<recob::Hit>>, N_VIEWS> mc_hits;
+        std::array<std::vector<art::Ptr<simb::MCParticle>>, N_VIEWS> max_ide_particle;
+        std::array<std::vector<double>, N_VIEWS> delta_ray_fraction;
+        std::array<std::unordered_map<int, std::vector<TruthHitMatch>>, N_VIEWS> track_hits;
+
+        // Creation process of every associated particle, by key in its collection
+        art::ProductID particle_product;
+        std::vector<Process> particle_process;
+        std::vector<bool> particle_resolved;
+
+        bool isFor(const art::Event& e) const { return valid && event == e.id(); }
+
+        const std::vector<bool>& badChannelMask() const
+        {
+            static const std::vector<bool> none;
+            return bad_channels != nullptr ? bad_channels->mask : none;
+        }
+
+        const BadChannelIndex& badChannelIndex() const
+        {
+            static const BadChannelIndex none;
+            return bad_channels != nullptr ? bad_channels->index : none;
+        }
+
+        bool isBadChannel(const raw::ChannelID_t ch) const
+        {
+            return this->badChannelIndex().isBad(ch);
+        }
+
+        Process process(const art::Ptr<simb::MCParticle>& mcp) const
+        {
+            if (mcp.id() == particle_product && mcp.key() < particle_resolved.size() && particle_resolved[mcp.key()])
+                return particle_process[mcp.key()];
+
+            return ProcessFromName(mcp->Process());
+        }
+
+        const std::vector<TruthHitMatch>& matches(const PandoraView view, const int track_id) const
+        {
+            static const std::vector<TruthHitMatch> none;
+            if (view < TPC_VIEW_U || view >= N_VIEWS)
+                return none;
+
+            const auto it = track_hits[view].find(track_id);
+            return it != track_hits[view].end() ? it->second : none;
+        }
+
+        void clear()
+        {
+            valid = false;
+            hit_product = art::ProductID();
+            hits.clear();
+            owners.clear();
+            assoc.reset();
+            bad_channels.reset();
+            particle_product = art::ProductID();
+            particle_process.clear();
+            particle_resolved.clear();
+            for (int v = TPC_VIEW_U; v != N_VIEWS; ++v)
+            {
+                mc_hits[v].clear();
+                max_ide_particle[v].clear();
+                delta_ray_fraction[v].clear();
+                track_hits[v].clear();
+            }
+        }
+    };
+
+    // Returns false, leaving the context invalid, if the hit product is missing. bad_channels may
+    // be null, in which case no channel is skipped. The owners are read from the HitTruthOwnerProducer
+    // arrays under owner_tag when it is set and they are in the event. The per-plane matches are only
+    // filled when with_matches is set, so a caller that needs the owners alone and finds them in the
+    // event never reads the backtracker associations
+    bool BuildEventTruthContext(const art::Event& e,
+                                const art::InputTag& hit_tag,
+                                const art::InputTag& backtrack_tag,
+                                const art::InputTag& owner_tag,
+                                std::shared_ptr<const BadChannelSet> bad_channels,
+                                const bool with_matches,
+                                EventTruthContext& ctx)
+    {
+        ctx.clear();
+        ctx.event = e.id();
+        ctx.bad_channels = std::move(bad_channels);
+
+        art::Handle<std::vector<recob::Hit>> hit_h;
+        if (!e.getByLabel(hit_tag, hit_h))
+            return false;
+
+        ctx.hit_product = hit_h.id();
+        art::fill_ptr_vector(ctx.hits, hit_h);
+
+        const bool owners_read = !owner_tag.label().empty() && GetHitTruthOwners(e, owner_tag, ctx.hit_product, ctx.hits.size(), ctx.owners);
+        if (owners_read && !with_matches)
+        {
+            ctx.valid = true;
+            return true;
+        }
+
+        // Each particle's process name is resolved the first time one of its associations is seen
+        static thread_local ProcessInterner interner;
+        ctx.assoc = std::make_unique<art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>>(hit_h, e, backtrack_tag);
+        if (!owners_read)
+        {
+            if (ctx.assoc->isValid())
+                FillHitTruthOwners(*ctx.assoc, interner, ctx.owners);
+            else
+                ctx.owners.assign(ctx.hits.size());
+        }
+
+        if (!with_matches)
+        {
+            ctx.valid = true;
+            return true;
+        }
+
+        auto process = [&ctx](const art::Ptr<simb::MCParticle>& mcp) -> Process {
+            if (ctx.particle_product == art::ProductID())
+                ctx.particle_product = mcp.id();
+            if (mcp.id() != ctx.particle_product)
+                return interner(mcp->Process());
+
+            if (mcp.key() >= ctx.particle_resolved.size())
+            {
+                ctx.particle_resolved.resize(mcp.key() + 1, false);
+                ctx.particle_process.resize(mcp.key() + 1, Process::kOther);
+            }
+            if (!ctx.particle_resolved[mcp.key()])
+            {
+                ctx.particle_process[mcp.key()] = interner(mcp->Process());
+                ctx.particle_resolved[mcp.key()] = true;
+            }
+
+            return ctx.particle_process[mcp.key()];
+        };
+
+        for (const auto& hit : ctx.hits)
+        {
+            if (ctx.isBadChannel(hit->Channel()))
+                continue;
+
+            const unsigned int plane = hit->WireID().Plane;
+            if (plane >= static_cast<unsigned int>(N_VIEWS))
+                continue;
+
+            const auto& assmcp = ctx.assoc->at(hit.key());
+            const auto& assmdt = ctx.assoc->data(hit.key());
+
+            double e_frac = 0.0;
+            for (size_t ia = 0; ia < assmcp.size(); ++ia)
+            {
+                if (std::abs(assmcp[ia]->PdgCode()) == 11 && process(assmcp[ia]) != Process::kPrimary)
+                    e_frac += assmdt[ia]->ideNFraction;
+            }
+
+            auto& mc_hits = ctx.mc_hits[plane];
+            auto& track_hits = ctx.track_hits[plane];
+            for (size_t im = 0; im < assmcp.size(); ++im)
+            {
+                if (assmdt[im]->isMaxIDEN != 1)
+                    continue;
+
+                const uint32_t index = mc_hits.size();
+                mc_hits.push_back(hit);
+                ctx.max_ide_particle[plane].push_back(assmcp[im]);
+                ctx.delta_ray_fraction[plane].push_back(e_frac);
+
+                for (size_t ia = 0; ia < assmcp.size(); ++ia)
+                    track_hits[assmcp[ia]->TrackId()].push_back({index, assmdt[ia]});
+            }
+        }
+
+        ctx.valid = true;
+        return true;
+    }
+}
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef HITINDEX_H
+#define HITINDEX_H
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+namespace common
+{
+    // Implicit k-d tree over the (drift, wire) positions of the hits of one plane, for rectangle
+    // and radius queries that visit only the part of the plane they cover. Each point carries an
+    // id chosen by the caller, typically a hit table row. Points are added, then build() orders
+    // them in place into the tree; it must be called before any query
+    class HitIndex2D
+    {
+    public:
+        struct Point
+        {
+            float x;
+            float z;
+            uint32_t id;
+        };
+
+        void clear()
+        {
+            _points.clear();
+            _built = false;
+        }
+
+        void reserve(const size_t n) { _points.reserve(n); }
+        void add(const float x, const float z, const uint32_t id) { _points.push_back({x, z, id}); }
+
+        void build()
+        {
+            this->buildNode(0, _points.size(), 0);
+            _built = true;
+        }
+
+        size_t size() const { return _points.size(); }
+        bool empty() const { return _points.empty(); }
+        bool built() const { return _built; }
+
+        // Calls function(id) for every point with x_min <= x <= x_max and z_min <= z <= z_max
+        template <typename Function>
+        void forEachInRect(const float x_min, const float x_max, const float z_min, const float z_max, Function&& function) const
+        {
+            this->rectNode(0, _points.size(), 0, x_min, x_max, z_min, z_max, function);
+        }
+
+        // Calls function(id, d2) for every point within radius of (x, z), d2 being its squared distance
+        template <typename Function>
+        void forEachInRadius(const float x, const float z, const float radius, Function&& function) const
+        {
+            if (radius < 0.f)
+                return;
+
+            this->radiusNode(0, _points.size(), 0, x, z, radius, radius * radius, function);
+        }
+
+    private:
+        static float key(const Point& p, const int axis) { return axis == 0 ? p.x : p.z; }
+
+        void buildNode(const size_t lo, const size_t hi, const int axis)
+        {
+            if (hi - lo < 2)
+                return;
+
+            const size_t mid = lo + (hi - lo) / 2;
+            std::nth_element(_points.begin() + lo, _points.begin() + mid, _points.begin() + hi,
+                             [axis](const Point& a, const Point& b) { return key(a, axis) < key(b, axis); });
+
+            this->buildNode(lo, mid, axis ^ 1);
+            this->buildNode(mid + 1, hi, axis ^ 1);
+        }
+
+        template <typename Function>
+        void rectNode(const size_t lo, const size_t hi, const int axis,
+                      const float x_min, const float x_max, const float z_min, const float z_max, Function& function) const
+        {
+            if (lo >= hi)
+                return;
+
+            const size_t mid = lo + (hi - lo) / 2;
+            const Point& p = _points[mid];
+            if (p.x >= x_min && p.x <= x_max && p.z >= z_min && p.z <= z_max)
+                function(p.id);
+
+            const float split = key(p, axis);
+            if ((axis == 0 ? x_min : z_min) <= split)
+                this->rectNode(lo, mid, axis ^ 1, x_min, x_max, z_min, z_max, function);
+            if ((axis == 0 ? x_max : z_max) >= split)
+                this->rectNode(mid + 1, hi, axis ^ 1, x_min, x_max, z_min, z_max, function);
+        }
+
+        template <typename Function>
+        void radiusNode(const size_t lo, const size_t hi, const int axis,
+                        const float x, const float z, const float radius, const float radius2, Function& function) const
+        {
+            if (lo >= hi)
+                return;
+
+            const size_t mid = lo + (hi - lo) / 2;
+            const Point& p = _points[mid];
+            const float dx = p.x - x, dz = p.z - z;
+            const float d2 = dx * dx + dz * dz;
+            if (d2 <= radius2)
+                function(p.id, d2);
+
+            const float split = key(p, axis);
+            const float q = axis == 0 ? x : z;
+            if (q - radius <= split)
+                this->radiusNode(lo, mid, axis ^ 1, x, z, radius, radius2, function);
+            if (q + radius >= split)
+                this->radiusNode(mid + 1, hi, axis ^ 1, x, z, radius, radius2, function);
+        }
+
+        std::vector<Point> _points;
+        bool _built = false;
+    };
+}
+
+#endif
@@ -0,0 +1,168 @@
+#ifndef HITTABLE_H
+#define HITTABLE_H
+
+#include "art/Framework/Principal/Event.h"
+#include "larcore/Geometry/Geometry.h"
+#include "lardata/DetectorInfoServices/DetectorPropertiesService.h"
+#include "lardataobj/RecoBase/Hit.h"
+#include "larreco/Calorimetry/CalorimetryAlg.h"
+
+#include "CommonFunctions/Pandora.h"
+#include "CommonFunctions/WireGeometry.h"
+#include "CommonFunctions/HitIndex.h"
+
+#include "TVector3.h"
+
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <cstdint>
+
+namespace common
+{
+    // Flat per-event view of the hit collection, filled once so that the geometry
+    // walk and calorimetry conversion are not repeated by every consumer of a hit
+    struct EventHitTable
+    {
+        std::vector<art::Ptr<recob::Hit>> hits;
+        std::vector<PandoraView> view;
+        std::vector<float> drift;
+        std::vector<float> wire;
+        std::vector<float> charge;
+        std::vector<raw::ChannelID_t> channel;
+        std::vector<uint8_t> bad_channel;
+
+        std::vector<int> key_to_row;
+
+        size_t size() const { return hits.size(); }
+
+        void clear()
+        {
+            hits.clear();
+            view.clear();
+            drift.clear();
+            wire.clear();
+            charge.clear();
+            channel.clear();
+            bad_channel.clear();
+            key_to_row.clear();
+        }
+
+        int row(const art::Ptr<recob::Hit>& hit) const
+        {
+            if (hit.key() >= key_to_row.size())
+                return -1;
+
+            return key_to_row[hit.key()];
+        }
+
+        TVector3 position(const size_t i) const
+        {
+            return TVector3(drift[i], 0.f, wire[i]);
+        }
+
+        TVector3 position(const art::Ptr<recob::Hit>& hit) const
+        {
+            const int i = this->row(hit);
+            if (i < 0)
+                throw cet::exception("EventHitTable") << "hit with key " << hit.key() << " not in table";
+
+            return this->position(i);
+        }
+    };
+
+    // Hits on channels set in bad_channel_mask are flagged in bad_channel; the mask is only read,
+    // and a null mask flags none
+    void BuildEventHitTable(const std::vector<art::Ptr<recob::Hit>>& hits,
+                            const calo::CalorimetryAlg* calo_alg,
+                            const std::vector<bool>* bad_channel_mask,
+                            EventHitTable& table,
+                            const WireGeometryLUT* wire_lut = nullptr)
+    {
+        table.clear();
+
+        const size_t n_hits = hits.size();
+        table.hits = hits;
+        table.view.resize(n_hits);
+        table.drift.resize(n_hits);
+        table.wire.resize(n_hits);
+        table.charge.resize(n_hits);
+        table.channel.resize(n_hits);
+        table.bad_channel.resize(n_hits, 0);
+
+        const geo::GeometryCore* geo = art::ServiceHandle<geo::Geometry>()->provider();
+        auto const* det = lar::providerFrom<detinfo::DetectorPropertiesService>();
+
+        size_t max_key = 0;
+        for (const auto& hit : hits)
+            max_key = std::max(max_key, static_cast<size_t>(hit.key()));
+        table.key_to_row.assign(n_hits > 0 ? max_key + 1 : 0, -1);
+
+        for (size_t i = 0; i < n_hits; ++i)
+        {
+            const art::Ptr<recob::Hit>& hit = hits[i];
+            const geo::WireID hit_wire(hit->WireID());
+            const PandoraView pandora_view = GetPandoraView(hit);
+
+            const double x_coord = det->ConvertTicksToX(hit->PeakTime(), hit_wire.Plane, hit_wire.TPC, hit_wire.Cryostat);
+
+            table.view[i] = pandora_view;
+            table.drift[i] = x_coord;
+
+            if (wire_lut != nullptr && hit->Channel() < wire_lut->nChannels())
+            {
+                table.wire[i] = wire_lut->projection(hit->Channel(), pandora_view);
+            }
+            else
+            {
+                const TVector3 xyz = geo->Cryostat(hit_wire.Cryostat).TPC(hit_wire.TPC).Plane(hit_wire.Plane).Wire(hit_wire.Wire).GetCenter();
+                table.wire[i] = pandora_view == TPC_VIEW_U ? YZtoU(xyz.Y(), xyz.Z()) : pandora_view == TPC_VIEW_V ? YZtoV(xyz.Y(), xyz.Z()) : YZtoW(xyz.Y(), xyz.Z());
+            }
+
+            table.charge[i] = calo_alg != nullptr ? calo_alg->ElectronsFromADCArea(hit->Integral(), hit_wire.Plane) : hit->Integral();
+            table.channel[i] = hit->Channel();
+
+            if (bad_channel_mask != nullptr && hit->Channel() < bad_channel_mask->size())
+                table.bad_channel[i] = (*bad_channel_mask)[hit->Channel()];
+
+            table.key_to_row[hit.key()] = i;
+        }
+    }
+
+    void BuildEventHitTable(const art::Event& e,
+                            const art::InputTag& hit_producer,
+                            const calo::CalorimetryAlg* calo_alg,
+                            const std::vector<bool>* bad_channel_mask,
+                            EventHitTable& table,
+                            const WireGeometryLUT* wire_lut = nullptr)
+    {
+        table.clear();
+
+        art::Handle<std::vector<recob::Hit>> hit_handle;
+        if (!e.getByLabel(hit_producer, hit_handle))
+            return;
+
+        std::vector<art::Ptr<recob::Hit>> hits;
+        art::fill_ptr_vector(hits, hit_handle);
+        BuildEventHitTable(hits, calo_alg, bad_channel_mask, table, wire_lut);
+    }
+
+    // Per-view k-d trees over the (drift, wire) positions of every row of the table, each point
+    // carrying its row. Built once per event after the table, and shared by the region, radial and
+    // cropping queries on it; callers skip rows they do not want, such as bad-channel hits
+    using EventHitIndex = std::array<HitIndex2D, N_VIEWS>;
+
+    void BuildEventHitIndex(const EventHitTable& table, EventHitIndex& index)
+    {
+        for (auto& view_index : index)
+            view_index.clear();
+
+        for (size_t i = 0; i < table.size(); ++i)
+            index[table.view[i]].add(table.drift[i], table.wire[i], i);
+
+        for (auto& view_index : index)
+            view_index.build();
+    }
+}
+
+#endif
@@ -0,0 +1,155 @@
+#ifndef HITTRUTHOWNERS_H
+#define HITTRUTHOWNERS_H
+
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Handle.h"
+#include "art/Framework/Principal/Provenance.h"
+#include "canvas/Persistency/Common/FindManyP.h"
+#include "canvas/Persistency/Common/Ptr.h"
+#include "canvas/Persistency/Provenance/ProductID.h"
+#include "canvas/Utilities/InputTag.h"
+#include "cetlib_except/exception.h"
+#include "fhiclcpp/ParameterSet.h"
+
+#include "lardataobj/AnalysisBase/BackTrackerMatchingData.h"
+#include "lardataobj/RecoBase/Hit.h"
+#include "nusimdata/SimulationBase/MCParticle.h"
+
+#include "CommonFunctions/Processes.h"
+
+#include <vector>
+#include <string>
+#include <cstdlib>
+
+namespace common
+{
+    constexpr int kNoTruthOwner = -1;
+
+    // Instance names of the HitTruthOwnerProducer products, one array of each per hit collection
+    const std::string kTruthOwnerTrackIdInstance = "trackid";
+    const std::string kTruthOwnerEnergyFractionInstance = "energyfraction";
+    const std::string kTruthOwnerDeltaRayFractionInstance = "deltarayfraction";
+
+    // Max-IDE truth owner of every hit of a collection, indexed by hit key: the TrackId of the
+    // particle of the hit's isMaxIDE association, the fraction of the hit's energy that particle
+    // deposited, and the fraction of the hit's charge from non-primary electrons. Hits with no
+    // max-IDE association hold kNoTruthOwner
+    struct HitTruthOwners
+    {
+        std::vector<int> track_id;
+        std::vector<float> energy_fraction;
+        std::vector<float> delta_ray_fraction;
+
+        size_t size() const { return track_id.size(); }
+
+        void clear()
+        {
+            track_id.clear();
+            energy_fraction.clear();
+            delta_ray_fraction.clear();
+        }
+
+        // n hits, none of them with an owner
+        void assign(const size_t n)
+        {
+            track_id.assign(n, kNoTruthOwner);
+            energy_fraction.assign(n, 0.f);
+            delta_ray_fraction.assign(n, 0.f);
+        }
+
+        int trackId(const art::Ptr<recob::Hit>& hit) const
+        {
+            return hit.key() < track_id.size() ? track_id[hit.key()] : kNoTruthOwner;
+        }
+
+        bool isSimulated(const art::Ptr<recob::Hit>& hit) const
+        {
+            return this->trackId(hit) != kNoTruthOwner;
+        }
+    };
+
+    // Walks the backtracker associations of a hit collection once. The first isMaxIDE association
+    // of a hit is its owner
+    void FillHitTruthOwners(const art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>& assoc,
+                            ProcessInterner& interner,
+                            HitTruthOwners& owners)
+    {
+        const size_t n = assoc.size();
+        owners.assign(n);
+
+        for (size_t ih = 0; ih < n; ++ih)
+        {
+            const auto& assmcp = assoc.at(ih);
+            const auto& assmdt = assoc.data(ih);
+
+            double e_frac = 0.0;
+            for (size_t ia = 0; ia < assmcp.size(); ++ia)
+            {
+                if (std::abs(assmcp[ia]->PdgCode()) == 11 && interner(assmcp[ia]->Process()) != Process::kPrimary)
+                    e_frac += assmdt[ia]->ideNFraction;
+
+                if (assmdt[ia]->isMaxIDE == 1 && owners.track_id[ih] == kNoTruthOwner)
+                {
+                    owners.track_id[ih] = assmcp[ia]->TrackId();
+                    owners.energy_fraction[ih] = assmdt[ia]->ideFraction;
+                }
+            }
+
+            owners.delta_ray_fraction[ih] = e_frac;
+        }
+    }
+
+    // Reads the owners of a hit collection written by HitTruthOwnerProducer under owner_tag.
+    // Returns false, leaving owners empty, if any of the arrays is missing. The arrays are indexed
+    // by hit key, so they are only accepted if the producer was run on the caller's hit product,
+    // hit_product of n_hits hits, found through the HitProducer of the producer's configuration;
+    // anything else throws rather than silently misaligning the keys
+    bool GetHitTruthOwners(const art::Event& e, const art::InputTag& owner_tag,
+                           const art::ProductID& hit_product, const size_t n_hits,
+                           HitTruthOwners& owners)
+    {
+        owners.clear();
+
+        art::Handle<std::vector<int>> track_id_h;
+        art::Handle<std::vector<float>> energy_fraction_h, delta_ray_fraction_h;
+        if (!e.getByLabel(art::InputTag(owner_tag.label(), kTruthOwnerTrackIdInstance, owner_tag.process()), track_id_h) ||
+            !e.getByLabel(art::InputTag(owner_tag.label(), kTruthOwnerEnergyFractionInstance, owner_tag.process()), energy_fraction_h) ||
+            !e.getByLabel(art::InputTag(owner_tag.label(), kTruthOwnerDeltaRayFractionInstance, owner_tag.process()), delta_ray_fraction_h))
+            return false;
+
+        const art::InputTag source_tag = track_id_h.provenance()->parameterSet().get<art::InputTag>("HitProducer", "gaushit");
+        art::Handle<std::vector<recob::Hit>> source_h;
+        if (!e.getByLabel(source_tag, source_h) || source_h.id() != hit_product)
+            throw cet::exception("HitTruthOwners") << "Truth owners " << owner_tag.encode() << " were made from the hits "
+                                                   << source_tag.encode() << ", not from the hit product being read";
+
+        if (track_id_h->size() != n_hits || energy_fraction_h->size() != n_hits || delta_ray_fraction_h->size() != n_hits)
+            throw cet::exception("HitTruthOwners") << "Truth owners " << owner_tag.encode() << " hold " << track_id_h->size()
+                                                   << " hits, the hit product " << n_hits;
+
+        owners.track_id = *track_id_h;
+        owners.energy_fraction = *energy_fraction_h;
+        owners.delta_ray_fraction = *delta_ray_fraction_h;
+
+        return true;
+    }
+
+    // Owners of the whole hit collection hit_h, read from owner_tag when it is set and the arrays are
+    // in the event, otherwise found from the backtracker associations under backtrack_tag. Without
+    // either, every hit is left without an owner
+    void LoadHitTruthOwners(const art::Event& e, const art::Handle<std::vector<recob::Hit>>& hit_h,
+                            const art::InputTag& owner_tag, const art::InputTag& backtrack_tag,
+                            ProcessInterner& interner, HitTruthOwners& owners)
+    {
+        if (!owner_tag.label().empty() && GetHitTruthOwners(e, owner_tag, hit_h.id(), hit_h->size(), owners))
+            return;
+
+        art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData> assoc(hit_h, e, backtrack_tag);
+        if (assoc.isValid())
+            FillHitTruthOwners(assoc, interner, owners);
+        else
+            owners.assign(hit_h->size());
+    }
+}
+
+#endif
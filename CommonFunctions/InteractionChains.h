@@ -0,0 +1,165 @@
+#ifndef INTERACTIONCHAINS_H
+#define INTERACTIONCHAINS_H
+
+#include "CommonFunctions/MCParticleGraph.h"
+#include "CommonFunctions/Scatters.h"
+
+#include <vector>
+#include <utility>
+#include <cstdlib>
+#include <cstdint>
+
+namespace common
+{
+    // Scatter chains, end states and pion chains of every particle of an MCParticleGraph, built
+    // bottom-up in one pass per event so that each query is a lookup. The scatter counts, last
+    // scattered particle and end state of a particle are those of GetNScatters and GetEndState,
+    // and its pion chain is GetPionChain, stored as the particle's subtree in a pre-order of the
+    // pion-only trees of the event
+    class InteractionChains
+    {
+    public:
+        void build(const MCParticleGraph& graph)
+        {
+            const size_t n = graph.size();
+
+            _next.assign(n, MCParticleGraph::kNone);
+            _step_elastic.assign(n, 0);
+            for (size_t i = 0; i < n; ++i)
+                _next[i] = GetScatterStep(graph, i, _step_elastic[i]);
+
+            _scattered.assign(n, MCParticleGraph::kNone);
+            _n_elastic.assign(n, 0);
+            _n_inelastic.assign(n, 0);
+            std::vector<int> chain;
+            for (size_t i = 0; i < n; ++i)
+            {
+                int j = i;
+                chain.clear();
+                while (_scattered[j] == MCParticleGraph::kNone && _next[j] != MCParticleGraph::kNone && chain.size() <= n)
+                {
+                    chain.push_back(j);
+                    j = _next[j];
+                }
+
+                if (_scattered[j] == MCParticleGraph::kNone)
+                {
+                    _scattered[j] = j;
+                    _n_elastic[j] = _step_elastic[j];
+                }
+
+                for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+                {
+                    const int k = *it;
+                    _scattered[k] = _scattered[_next[k]];
+                    _n_elastic[k] = _step_elastic[k] + _n_elastic[_next[k]];
+                    _n_inelastic[k] = _n_inelastic[_next[k]] + 1;
+                }
+            }
+
+            _end_state.assign(n, EndState::kNone);
+            for (size_t i = 0; i < n; ++i)
+            {
+                if (_scattered[i] == static_cast<int>(i))
+                    _end_state[i] = GetScatteredEndState(graph, i);
+            }
+            for (size_t i = 0; i < n; ++i)
+                _end_state[i] = _end_state[_scattered[i]];
+
+            this->buildPionChains(graph);
+        }
+
+        size_t size() const { return _scattered.size(); }
+
+        unsigned int nElastic(const size_t i) const { return _n_elastic[i]; }
+        unsigned int nInelastic(const size_t i) const { return _n_inelastic[i]; }
+        int scattered(const size_t i) const { return _scattered[i]; }
+        EndState endState(const size_t i) const { return _end_state[i]; }
+
+        // The pion and its pion descendants in GetPionChain order, empty for anything but a pion
+        MCParticleGraph::IndexRange pionChain(const size_t i) const
+        {
+            const int32_t* data = _pion_order.data();
+            return MCParticleGraph::IndexRange(data + _pion_begin[i], data + _pion_end[i]);
+        }
+
+        // First pion of the chain the particle belongs to, kNone for anything but a pion
+        int pionChainRoot(const size_t i) const { return _pion_root[i]; }
+
+    private:
+        void buildPionChains(const MCParticleGraph& graph)
+        {
+            const size_t n = graph.size();
+            auto isPion = [&graph](const int i) { return std::abs(graph.particle(i)->PdgCode()) == 211; };
+
+            std::vector<bool> has_pion_parent(n, false);
+            for (size_t i = 0; i < n; ++i)
+            {
+                if (!isPion(i))
+                    continue;
+
+                for (const int daughter : graph.daughters(i))
+                {
+                    if (isPion(daughter))
+                        has_pion_parent[daughter] = true;
+                }
+            }
+
+            _pion_order.clear();
+            _pion_begin.assign(n, 0);
+            _pion_end.assign(n, 0);
+            _pion_root.assign(n, MCParticleGraph::kNone);
+
+            std::vector<std::pair<int, size_t>> stack;
+            for (size_t root = 0; root < n; ++root)
+            {
+                if (!isPion(root) || has_pion_parent[root])
+                    continue;
+
+                auto enter = [&](const int i) {
+                    _pion_root[i] = root;
+                    _pion_begin[i] = _pion_order.size();
+                    _pion_order.push_back(i);
+                    stack.emplace_back(i, 0);
+                };
+
+                enter(root);
+                while (!stack.empty())
+                {
+                    const int node = stack.back().first;
+                    const auto daughters = graph.daughters(node);
+
+                    size_t k = stack.back().second;
+                    while (k < daughters.size() && (!isPion(daughters[k]) || _pion_root[daughters[k]] != MCParticleGraph::kNone))
+                        ++k;
+
+                    if (k < daughters.size())
+                    {
+                        stack.back().second = k + 1;
+                        enter(daughters[k]);
+                    }
+                    else
+                    {
+                        _pion_end[node] = _pion_order.size();
+                        stack.pop_back();
+                    }
+                }
+            }
+        }
+
+        std::vector<int> _next;
+        std::vector<unsigned int> _step_elastic;
+
+        std::vector<int> _scattered;
+        std::vector<unsigned int> _n_elastic;
+        std::vector<unsigned int> _n_inelastic;
+        std::vector<EndState> _end_state;
+
+        std::vector<int32_t> _pion_order;
+        std::vector<uint32_t> _pion_begin;
+        std::vector<uint32_t> _pion_end;
+        std::vector<int> _pion_root;
+    };
+}
+
+#endif
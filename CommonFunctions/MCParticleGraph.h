@@ -0,0 +1,186 @@
+#ifndef MCPARTICLEGRAPH_H
+#define MCPARTICLEGRAPH_H
+
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Handle.h"
+#include "canvas/Persistency/Common/Ptr.h"
+#include "canvas/Persistency/Provenance/EventID.h"
+#include "canvas/Utilities/InputTag.h"
+
+#include "nusimdata/SimulationBase/MCParticle.h"
+
+#include "CommonFunctions/Processes.h"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace common
+{
+    // The MCParticle collection of an event as a graph over the collection indices, built once
+    // per event and shared by every consumer. TrackIds are resolved through an open-addressing
+    // hash, daughters are stored contiguously per particle in the order of Daughter(k), skipping
+    // those not in the collection as GetDaughters does, and process and end-process names are
+    // resolved to Process codes so that they compare without string operations. If a TrackId
+    // repeats, the last particle carrying it is the one found
+    class MCParticleGraph
+    {
+    public:
+        static constexpr int kNone = -1;
+
+        class IndexRange
+        {
+        public:
+            IndexRange(const int32_t* first, const int32_t* last) : _first(first), _last(last) {}
+
+            const int32_t* begin() const { return _first; }
+            const int32_t* end() const { return _last; }
+            size_t size() const { return _last - _first; }
+            bool empty() const { return _first == _last; }
+            int operator[](const size_t i) const { return _first[i]; }
+
+        private:
+            const int32_t* _first;
+            const int32_t* _last;
+        };
+
+        void build(const art::Event& e, const art::InputTag& mcp_tag)
+        {
+            this->build(e.getValidHandle<std::vector<simb::MCParticle>>(mcp_tag));
+            _event = e.id();
+            _valid = true;
+        }
+
+        void build(const art::ValidHandle<std::vector<simb::MCParticle>>& mcp_h)
+        {
+            const size_t n = mcp_h->size();
+            _valid = false;
+            _n_duplicates = 0;
+
+            _particles.clear();
+            _particles.reserve(n);
+            _track_id.resize(n);
+            for (size_t i = 0; i < n; ++i)
+            {
+                _particles.emplace_back(mcp_h, i);
+                _track_id[i] = (*mcp_h)[i].TrackId();
+            }
+
+            size_t n_slots = 16;
+            while (n_slots < 2 * n)
+                n_slots <<= 1;
+            _mask = n_slots - 1;
+            _slots.assign(n_slots, kNone);
+            for (size_t i = 0; i < n; ++i)
+            {
+                size_t s = this->slot(_track_id[i]);
+                while (_slots[s] != kNone && _track_id[_slots[s]] != _track_id[i])
+                    s = (s + 1) & _mask;
+
+                if (_slots[s] != kNone)
+                    ++_n_duplicates;
+                _slots[s] = i;
+            }
+
+            _parent.assign(n, kNone);
+            _daughter_offset.assign(n + 1, 0);
+            _daughter_index.clear();
+            for (size_t i = 0; i < n; ++i)
+            {
+                const simb::MCParticle& mcp = (*mcp_h)[i];
+                _parent[i] = this->find(mcp.Mother());
+                for (int k = 0; k < mcp.NumberDaughters(); ++k)
+                {
+                    const int d = this->find(mcp.Daughter(k));
+                    if (d != kNone)
+                        _daughter_index.push_back(d);
+                }
+                _daughter_offset[i + 1] = _daughter_index.size();
+            }
+
+            _process.resize(n);
+            _end_process.resize(n);
+            for (size_t i = 0; i < n; ++i)
+            {
+                _process[i] = _interner((*mcp_h)[i].Process());
+                _end_process[i] = _interner((*mcp_h)[i].EndProcess());
+            }
+        }
+
+        bool isFor(const art::Event& e) const { return _valid && _event == e.id(); }
+
+        size_t size() const { return _particles.size(); }
+        size_t nDuplicates() const { return _n_duplicates; }
+
+        // Collection index of the particle with this TrackId, kNone if there is none
+        int find(const int track_id) const
+        {
+            if (_slots.empty())
+                return kNone;
+
+            for (size_t s = this->slot(track_id); _slots[s] != kNone; s = (s + 1) & _mask)
+            {
+                if (_track_id[_slots[s]] == track_id)
+                    return _slots[s];
+            }
+
+            return kNone;
+        }
+
+        int find(const art::Ptr<simb::MCParticle>& particle) const
+        {
+            return this->find(particle->TrackId());
+        }
+
+        const art::Ptr<simb::MCParticle>& particle(const size_t i) const { return _particles[i]; }
+        const std::vector<art::Ptr<simb::MCParticle>>& particles() const { return _particles; }
+
+        int trackId(const size_t i) const { return _track_id[i]; }
+        int parent(const size_t i) const { return _parent[i]; }
+
+        IndexRange daughters(const size_t i) const
+        {
+            const int32_t* data = _daughter_index.data();
+            return IndexRange(data + _daughter_offset[i], data + _daughter_offset[i + 1]);
+        }
+
+        std::vector<art::Ptr<simb::MCParticle>> daughterPtrs(const size_t i) const
+        {
+            std::vector<art::Ptr<simb::MCParticle>> daughters;
+            daughters.reserve(_daughter_offset[i + 1] - _daughter_offset[i]);
+            for (const int d : this->daughters(i))
+                daughters.push_back(_particles[d]);
+
+            return daughters;
+        }
+
+        Process process(const size_t i) const { return _process[i]; }
+        Process endProcess(const size_t i) const { return _end_process[i]; }
+
+    private:
+        size_t slot(const int track_id) const
+        {
+            return (static_cast<uint32_t>(track_id) * 2654435761u) & _mask;
+        }
+
+        art::EventID _event;
+        bool _valid = false;
+        size_t _n_duplicates = 0;
+
+        std::vector<art::Ptr<simb::MCParticle>> _particles;
+        std::vector<int> _track_id;
+
+        size_t _mask = 0;
+        std::vector<int32_t> _slots;
+
+        std::vector<int32_t> _parent;
+        std::vector<uint32_t> _daughter_offset;
+        std::vector<int32_t> _daughter_index;
+
+        std::vector<Process> _process;
+        std::vector<Process> _end_process;
+        ProcessInterner _interner;
+    };
+}
+
+#endif
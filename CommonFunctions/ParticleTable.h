@@ -0,0 +1,104 @@
+#ifndef PARTICLETABLE_H
+#define PARTICLETABLE_H
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+
+namespace common
+{
+    enum class ParticleClass : uint8_t
+    {
+        kTrack,
+        kShower,
+        kInvisible
+    };
+
+    // Properties of the particle with the positive PDG code; the antiparticle has the opposite charge.
+    // Masses in GeV, momentum thresholds in GeV/c with a negative value for none
+    struct ParticleProperties
+    {
+        int pdg;
+        int charge;
+        double mass;
+        ParticleClass type;
+        float threshold;
+    };
+
+    constexpr std::array<ParticleProperties, 22> kParticleTable = {{
+        {11, -1, 0.000510999, ParticleClass::kShower, 0.1f},        // e-
+        {12, 0, 0., ParticleClass::kInvisible, -1.f},               // nu_e
+        {13, -1, 0.105658, ParticleClass::kTrack, 0.1f},            // mu-
+        {14, 0, 0., ParticleClass::kInvisible, -1.f},               // nu_mu
+        {15, -1, 1.77686, ParticleClass::kTrack, -1.f},             // tau-
+        {16, 0, 0., ParticleClass::kInvisible, -1.f},               // nu_tau
+        {22, 0, 0., ParticleClass::kShower, -1.f},                  // gamma
+        {111, 0, 0.134977, ParticleClass::kShower, -1.f},           // pi0
+        {130, 0, 0.497611, ParticleClass::kInvisible, -1.f},        // K0L
+        {211, 1, 0.139570, ParticleClass::kTrack, 0.1f},            // pi+
+        {221, 0, 0.547862, ParticleClass::kShower, -1.f},           // eta
+        {310, 0, 0.497611, ParticleClass::kInvisible, -1.f},        // K0S
+        {311, 0, 0.497611, ParticleClass::kInvisible, -1.f},        // K0
+        {321, 1, 0.493677, ParticleClass::kTrack, 0.2f},            // K+
+        {2112, 0, 0.939565, ParticleClass::kInvisible, -1.f},       // n
+        {2212, 1, 0.938272, ParticleClass::kTrack, 0.3f},           // p
+        {3112, -1, 1.197449, ParticleClass::kTrack, 0.1f},          // Sigma-
+        {3122, 0, 1.115683, ParticleClass::kInvisible, -1.f},       // Lambda
+        {3212, 0, 1.192642, ParticleClass::kInvisible, -1.f},       // Sigma0
+        {3222, 1, 1.189370, ParticleClass::kTrack, 0.1f},           // Sigma+
+        {3312, -1, 1.32171, ParticleClass::kTrack, -1.f},           // Xi-
+        {3334, -1, 1.67245, ParticleClass::kTrack, -1.f},           // Omega-
+    }};
+
+    constexpr int kNoParticle = -1;
+    constexpr int kParticleIndexRange = 4096;
+
+    constexpr std::array<int8_t, kParticleIndexRange> MakeParticleIndex()
+    {
+        std::array<int8_t, kParticleIndexRange> index{};
+        for (auto& entry : index)
+            entry = kNoParticle;
+        for (size_t i = 0; i < kParticleTable.size(); ++i)
+            index[kParticleTable[i].pdg] = i;
+
+        return index;
+    }
+
+    constexpr std::array<int8_t, kParticleIndexRange> kParticleIndex = MakeParticleIndex();
+
+    // Position of the particle, or its antiparticle, in kParticleTable, kNoParticle if absent
+    constexpr int ParticleIndex(const int pdg)
+    {
+        const int abs_pdg = pdg < 0 ? -pdg : pdg;
+        return abs_pdg < kParticleIndexRange ? kParticleIndex[abs_pdg] : kNoParticle;
+    }
+
+    constexpr bool IsNucleus(const int pdg)
+    {
+        return (pdg < 0 ? -pdg : pdg) >= 1000000000;
+    }
+
+    // Charge in units of e. Nuclei are given their atomic number, and particles not in the table zero
+    constexpr int ParticleCharge(const int pdg)
+    {
+        if (IsNucleus(pdg))
+            return ((pdg < 0 ? -pdg : pdg) / 10000) % 1000;
+
+        const int index = ParticleIndex(pdg);
+        if (index == kNoParticle)
+            return 0;
+
+        return pdg < 0 ? -kParticleTable[index].charge : kParticleTable[index].charge;
+    }
+
+    constexpr double ParticleMass(const int pdg)
+    {
+        const int index = ParticleIndex(pdg);
+        return index != kNoParticle ? kParticleTable[index].mass : 0.;
+    }
+
+    static_assert(ParticleIndex(-211) == ParticleIndex(211) && ParticleIndex(211) != kNoParticle, "particle index");
+    static_assert(ParticleCharge(-211) == -1 && ParticleCharge(11) == -1 && ParticleCharge(111) == 0, "particle charge");
+}
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef PROCESSES_H
+#define PROCESSES_H
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <cstdint>
+
+namespace common
+{
+    // Geant4 process names of MCParticle::Process and EndProcess. The inelastic processes are
+    // contiguous so that IsInelastic is a range check; inelastic names not listed map to
+    // kOtherInelastic and every other unlisted name to kOther
+    enum class Process : uint8_t
+    {
+        kOther,
+        kPrimary,
+        kDecay,
+        kHadElastic,
+        kCoulombScat,
+        kHIoni,
+        kEIoni,
+        kMuIoni,
+        kEBrem,
+        kCompt,
+        kPhot,
+        kConv,
+        kAnnihil,
+        kMuMinusCaptureAtRest,
+        kNCapture,
+        kFastScintillation,
+        kCoupledTransportation,
+        kPiPlusInelastic,
+        kPiMinusInelastic,
+        kProtonInelastic,
+        kNeutronInelastic,
+        kKaonPlusInelastic,
+        kKaonMinusInelastic,
+        kKaon0LInelastic,
+        kLambdaInelastic,
+        kSigmaPlusInelastic,
+        kSigmaMinusInelastic,
+        kOtherInelastic
+    };
+
+    constexpr std::array<std::pair<std::string_view, Process>, 27> kProcessNames = {{
+        {"primary", Process::kPrimary},
+        {"Decay", Process::kDecay},
+        {"hadElastic", Process::kHadElastic},
+        {"CoulombScat", Process::kCoulombScat},
+        {"hIoni", Process::kHIoni},
+        {"eIoni", Process::kEIoni},
+        {"muIoni", Process::kMuIoni},
+        {"eBrem", Process::kEBrem},
+        {"compt", Process::kCompt},
+        {"phot", Process::kPhot},
+        {"conv", Process::kConv},
+        {"annihil", Process::kAnnihil},
+        {"muMinusCaptureAtRest", Process::kMuMinusCaptureAtRest},
+        {"nCapture", Process::kNCapture},
+        {"FastScintillation", Process::kFastScintillation},
+        {"CoupledTransportation", Process::kCoupledTransportation},
+        {"pi+Inelastic", Process::kPiPlusInelastic},
+        {"pi-Inelastic", Process::kPiMinusInelastic},
+        {"protonInelastic", Process::kProtonInelastic},
+        {"neutronInelastic", Process::kNeutronInelastic},
+        {"kaon+Inelastic", Process::kKaonPlusInelastic},
+        {"kaon-Inelastic", Process::kKaonMinusInelastic},
+        {"kaon0LInelastic", Process::kKaon0LInelastic},
+        {"lambdaInelastic", Process::kLambdaInelastic},
+        {"sigma+Inelastic", Process::kSigmaPlusInelastic},
+        {"sigma-Inelastic", Process::kSigmaMinusInelastic},
+        {"Inelastic", Process::kOtherInelastic},
+    }};
+
+    constexpr bool IsInelastic(const Process process)
+    {
+        return process >= Process::kPiPlusInelastic && process <= Process::kOtherInelastic;
+    }
+
+    Process ProcessFromName(const std::string_view name)
+    {
+        for (const auto& [process_name, process] : kProcessNames)
+        {
+            if (name == process_name)
+                return process;
+        }
+
+        return name.find("Inelastic") != std::string_view::npos ? Process::kOtherInelastic : Process::kOther;
+    }
+
+    std::string_view ProcessName(const Process process)
+    {
+        for (const auto& [process_name, code] : kProcessNames)
+        {
+            if (code == process)
+                return process_name;
+        }
+
+        return "Other";
+    }
+
+    // Remembers the code of every process name it has seen, so that each distinct name is
+    // resolved once per job rather than once per particle
+    class ProcessInterner
+    {
+    public:
+        Process operator()(const std::string& name)
+        {
+            const auto it = _codes.find(name);
+            if (it != _codes.end())
+                return it->second;
+
+            return _codes.emplace(name, ProcessFromName(name)).first->second;
+        }
+
+    private:
+        std::unordered_map<std::string, Process> _codes;
+    };
+}
+
+#endif
@@ -0,0 +1,256 @@
+#ifndef PROXIMITYCLUSTERER_H
+#define PROXIMITYCLUSTERER_H
+
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+
+namespace common
+{
+    // Hit quantities of the proximity clustering, filled once per hit. Times and widths are in cm
+    // and kept in the single precision the pairwise test has always used, so that clusters do not
+    // change with the engine
+    struct ProximityHits
+    {
+        std::vector<int> plane;
+        std::vector<float> peak;
+        std::vector<float> time;
+        std::vector<float> width;
+        std::vector<double> channel;
+        std::vector<int> cell_wire;
+        std::vector<int> cell_time;
+
+        float time2cm = 0.f;
+        float wire2cm = 0.f;
+
+        size_t size() const { return plane.size(); }
+
+        void clear()
+        {
+            plane.clear();
+            peak.clear();
+            time.clear();
+            width.clear();
+            channel.clear();
+            cell_wire.clear();
+            cell_time.clear();
+        }
+
+        void add(const int hit_plane, const float peak_time, const float rms, const unsigned int hit_channel, const unsigned int wire, const float cell_size)
+        {
+            plane.push_back(hit_plane);
+            peak.push_back(peak_time);
+            time.push_back(peak_time * time2cm);
+            width.push_back(rms * time2cm);
+            channel.push_back(hit_channel);
+
+            const double w = wire * wire2cm;
+            const double t = peak_time * time2cm;
+            cell_wire.push_back(int(w / cell_size));
+            cell_time.push_back(int(t / cell_size));
+        }
+
+        // Distance test of HitsCompatible: the time separation is the gap between the hit widths when
+        // the later hit is taken first, and the peak separation otherwise
+        bool compatible(const size_t h1, const size_t h2, const float radius) const
+        {
+            if (plane[h1] != plane[h2])
+                return false;
+
+            double dt = (peak[h1] - peak[h2]) * time2cm;
+
+            const float T1 = time[h1], T2 = time[h2];
+            const float W1 = width[h1], W2 = width[h2];
+            if (T1 > T2)
+            {
+                if ((T2 + W2) > (T1 - W1))
+                    dt = 0;
+                else if ((T1 - W1) - (T2 + W2) < dt)
+                    dt = (T1 - W1) - (T2 + W2);
+            }
+            else
+            {
+                if ((T1 + W1) > (T2 - W2))
+                    dt = 0;
+                else if ((T2 - W2) - (T1 + W1) < dt)
+                    dt = (T2 - W2) - (T1 + W1);
+            }
+
+            double dw = std::fabs((channel[h1] - channel[h2]) * wire2cm);
+            if (dw > 0.3)
+                dw -= 0.3;
+
+            const double d = dt * dt + dw * dw;
+            return !(d > (radius * radius));
+        }
+    };
+
+    // Proximity clustering of the hits of one plane. Hits are binned into cells of cell_size, the
+    // occupied cells are found through an open-addressing hash of their (wire, time) bin, and every
+    // hit is tested against the hits of its own and the eight surrounding cells. Compatible pairs
+    // are merged in a union-find forest, so a cluster is a connected set of compatible hits
+    class ProximityClusterer
+    {
+    public:
+        // Clusters are ordered by their first hit in (wire bin, time bin, hit index) order, and the
+        // hits of a cluster follow the same order
+        void cluster(const ProximityHits& hits, const std::vector<uint32_t>& plane_hits, const float radius, std::vector<std::vector<unsigned int>>& clusters)
+        {
+            const size_t n = plane_hits.size();
+            if (n == 0)
+                return;
+
+            _order.assign(plane_hits.begin(), plane_hits.end());
+            std::sort(_order.begin(), _order.end(), [&hits](const uint32_t a, const uint32_t b) {
+                if (hits.cell_wire[a] != hits.cell_wire[b])
+                    return hits.cell_wire[a] < hits.cell_wire[b];
+                if (hits.cell_time[a] != hits.cell_time[b])
+                    return hits.cell_time[a] < hits.cell_time[b];
+                return a < b;
+            });
+
+            this->buildCells(hits);
+
+            _parent.resize(n);
+            std::iota(_parent.begin(), _parent.end(), 0);
+            _size.assign(n, 1);
+
+            for (size_t c = 0; c + 1 < _cell_offset.size(); ++c)
+            {
+                const int i = _cell_wire[c], j = _cell_time[c];
+                for (int di = -1; di <= 1; ++di)
+                {
+                    for (int dj = -1; dj <= 1; ++dj)
+                    {
+                        const int nc = this->findCell(i + di, j + dj);
+                        if (nc < 0 || nc < static_cast<int>(c))
+                            continue;
+
+                        this->mergeCells(hits, c, nc, radius);
+                    }
+                }
+            }
+
+            _cluster_of_root.assign(n, -1);
+            const size_t first = clusters.size();
+            for (size_t k = 0; k < n; ++k)
+            {
+                const uint32_t root = this->find(k);
+                if (_cluster_of_root[root] < 0)
+                {
+                    _cluster_of_root[root] = clusters.size() - first;
+                    clusters.emplace_back();
+                    clusters.back().reserve(_size[root]);
+                }
+
+                clusters[first + _cluster_of_root[root]].push_back(_order[k]);
+            }
+        }
+
+    private:
+        void buildCells(const ProximityHits& hits)
+        {
+            _cell_offset.clear();
+            _cell_wire.clear();
+            _cell_time.clear();
+            for (size_t k = 0; k < _order.size(); ++k)
+            {
+                const int i = hits.cell_wire[_order[k]], j = hits.cell_time[_order[k]];
+                if (!_cell_wire.empty() && _cell_wire.back() == i && _cell_time.back() == j)
+                    continue;
+
+                _cell_offset.push_back(k);
+                _cell_wire.push_back(i);
+                _cell_time.push_back(j);
+            }
+            _cell_offset.push_back(_order.size());
+
+            const size_t n_cells = _cell_wire.size();
+            size_t n_slots = 16;
+            while (n_slots < 2 * n_cells)
+                n_slots <<= 1;
+            _mask = n_slots - 1;
+            _slots.assign(n_slots, -1);
+            for (size_t c = 0; c < n_cells; ++c)
+            {
+                size_t s = this->slot(_cell_wire[c], _cell_time[c]);
+                while (_slots[s] != -1)
+                    s = (s + 1) & _mask;
+                _slots[s] = c;
+            }
+        }
+
+        int findCell(const int i, const int j) const
+        {
+            for (size_t s = this->slot(i, j); _slots[s] != -1; s = (s + 1) & _mask)
+            {
+                if (_cell_wire[_slots[s]] == i && _cell_time[_slots[s]] == j)
+                    return _slots[s];
+            }
+
+            return -1;
+        }
+
+        size_t slot(const int i, const int j) const
+        {
+            const uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(i)) << 32) | static_cast<uint32_t>(j);
+            return (key * 0x9E3779B97F4A7C15ull >> 32) & _mask;
+        }
+
+        // Tests each pair of hits across two cells, or within one, in both orders as the pairwise
+        // test is not symmetric, skipping pairs already in the same cluster
+        void mergeCells(const ProximityHits& hits, const size_t c1, const size_t c2, const float radius)
+        {
+            for (uint32_t k1 = _cell_offset[c1]; k1 < _cell_offset[c1 + 1]; ++k1)
+            {
+                const uint32_t k2_begin = c1 == c2 ? k1 + 1 : _cell_offset[c2];
+                for (uint32_t k2 = k2_begin; k2 < _cell_offset[c2 + 1]; ++k2)
+                {
+                    const uint32_t r1 = this->find(k1), r2 = this->find(k2);
+                    if (r1 == r2)
+                        continue;
+
+                    if (hits.compatible(_order[k1], _order[k2], radius) || hits.compatible(_order[k2], _order[k1], radius))
+                        this->unite(r1, r2);
+                }
+            }
+        }
+
+        uint32_t find(uint32_t k)
+        {
+            while (_parent[k] != k)
+            {
+                _parent[k] = _parent[_parent[k]];
+                k = _parent[k];
+            }
+
+            return k;
+        }
+
+        void unite(uint32_t r1, uint32_t r2)
+        {
+            if (_size[r1] < _size[r2])
+                std::swap(r1, r2);
+
+            _parent[r2] = r1;
+            _size[r1] += _size[r2];
+        }
+
+        std::vector<uint32_t> _order;
+        std::vector<uint32_t> _cell_offset;
+        std::vector<int> _cell_wire;
+        std::vector<int> _cell_time;
+
+        size_t _mask = 0;
+        std::vector<int32_t> _slots;
+
+        std::vector<uint32_t> _parent;
+        std::vector<uint32_t> _size;
+        std::vector<int> _cluster_of_root;
+    };
+}
+
+#endif
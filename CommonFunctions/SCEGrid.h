@@ -0,0 +1,266 @@
+#ifndef SCEGRID_H
+#define SCEGRID_H
+
+#include "larevt/SpaceCharge/SpaceCharge.h"
+#include "larevt/SpaceChargeServices/SpaceChargeService.h"
+#include "larcore/Geometry/Geometry.h"
+#include "lardataobj/RecoBase/Track.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <random>
+#include <cmath>
+#include <cstdint>
+
+namespace common
+{
+    // Space charge position offsets sampled from the SpaceChargeService once per job onto a regular
+    // grid over the TPC and trilinearly interpolated. Points are moved with the same signs as
+    // ApplySCEMappingXYZ (simulation offsets) or ApplySCECorrectionXYZ (calibration offsets);
+    // points outside the grid, or every point if the grid was built with a spacing of zero, are
+    // sent to the service, and if the offsets are disabled in the service the grid is the identity
+    class SCEGrid
+    {
+    public:
+        enum class Offsets { kSimSpatial, kCalSpatial };
+
+        struct Precision
+        {
+            size_t n_points = 0;
+            double max_deviation = 0.;
+            double mean_deviation = 0.;
+        };
+
+        bool built() const { return _built; }
+        bool enabled() const { return _enabled; }
+        size_t nNodes() const { return _dx.size(); }
+
+        void build(const Offsets offsets, const double spacing)
+        {
+            auto const* sce = lar::providerFrom<spacecharge::SpaceChargeService>();
+            const geo::GeometryCore* geo = art::ServiceHandle<geo::Geometry>()->provider();
+
+            _offsets = offsets;
+            _enabled = offsets == Offsets::kSimSpatial ? sce->EnableSimSpatialSCE() : sce->EnableCalSpatialSCE();
+            _built = true;
+            _dx.clear();
+            _dy.clear();
+            _dz.clear();
+            _n = {0, 0, 0};
+            if (!_enabled || spacing <= 0.)
+                return;
+
+            const std::array<double, 3> lo = {0., -geo->DetHalfHeight(), 0.};
+            const std::array<double, 3> hi = {2. * geo->DetHalfWidth(), geo->DetHalfHeight(), geo->DetLength()};
+            for (int d = 0; d < 3; ++d)
+            {
+                _n[d] = std::max(2, static_cast<int>(std::ceil((hi[d] - lo[d]) / spacing)) + 1);
+                _lo[d] = lo[d];
+                _step[d] = (hi[d] - lo[d]) / (_n[d] - 1);
+                _inv_step[d] = 1.f / _step[d];
+            }
+
+            const size_t n_nodes = static_cast<size_t>(_n[0]) * _n[1] * _n[2];
+            _dx.resize(n_nodes);
+            _dy.resize(n_nodes);
+            _dz.resize(n_nodes);
+
+            for (int i = 0; i < _n[0]; ++i)
+                for (int j = 0; j < _n[1]; ++j)
+                    for (int k = 0; k < _n[2]; ++k)
+                    {
+                        const geo::Vector_t offset = this->serviceOffset(_lo[0] + i * _step[0], _lo[1] + j * _step[1], _lo[2] + k * _step[2]);
+                        const size_t node = this->node(i, j, k);
+                        _dx[node] = offset.X();
+                        _dy[node] = offset.Y();
+                        _dz[node] = offset.Z();
+                    }
+
+            mf::LogInfo("SCEGrid") << "Sampled " << (offsets == Offsets::kSimSpatial ? "simulation" : "calibration")
+                                   << " space charge offsets on a " << _n[0] << "x" << _n[1] << "x" << _n[2] << " grid";
+        }
+
+        void map(float& x, float& y, float& z) const
+        {
+            this->map(1, &x, &y, &z);
+        }
+
+        // Moves n points in place. The interpolation runs branch-free over the whole batch on
+        // separate coordinate arrays so that the compiler can vectorise it
+        void map(const size_t n, float* x, float* y, float* z) const
+        {
+            if (!_enabled || n == 0)
+                return;
+
+            if (_dx.empty())
+            {
+                for (size_t p = 0; p < n; ++p)
+                {
+                    const geo::Vector_t offset = this->serviceOffset(x[p], y[p], z[p]);
+                    x[p] -= offset.X();
+                    y[p] += offset.Y();
+                    z[p] += offset.Z();
+                }
+                return;
+            }
+
+            // Points off the grid are put through the service after the batch
+            std::vector<std::pair<size_t, std::array<float, 3>>> outside;
+            for (size_t p = 0; p < n; ++p)
+            {
+                if (!this->inside(x[p], y[p], z[p]))
+                    outside.push_back({p, {x[p], y[p], z[p]}});
+            }
+
+            const int nx = _n[0], ny = _n[1], nz = _n[2];
+            const float* dx = _dx.data();
+            const float* dy = _dy.data();
+            const float* dz = _dz.data();
+
+            for (size_t p = 0; p < n; ++p)
+            {
+                const float u = (x[p] - _lo[0]) * _inv_step[0];
+                const float v = (y[p] - _lo[1]) * _inv_step[1];
+                const float w = (z[p] - _lo[2]) * _inv_step[2];
+
+                const int i = std::min(std::max(static_cast<int>(std::floor(u)), 0), nx - 2);
+                const int j = std::min(std::max(static_cast<int>(std::floor(v)), 0), ny - 2);
+                const int k = std::min(std::max(static_cast<int>(std::floor(w)), 0), nz - 2);
+
+                const float fu = u - i, fv = v - j, fw = w - k;
+                const float gu = 1.f - fu, gv = 1.f - fv, gw = 1.f - fw;
+
+                const size_t c000 = (static_cast<size_t>(i) * ny + j) * nz + k;
+                const size_t c010 = c000 + nz;
+                const size_t c100 = c000 + static_cast<size_t>(ny) * nz;
+                const size_t c110 = c100 + nz;
+
+                const float w000 = gu * gv * gw, w001 = gu * gv * fw;
+                const float w010 = gu * fv * gw, w011 = gu * fv * fw;
+                const float w100 = fu * gv * gw, w101 = fu * gv * fw;
+                const float w110 = fu * fv * gw, w111 = fu * fv * fw;
+
+                const float ox = w000 * dx[c000] + w001 * dx[c000 + 1] + w010 * dx[c010] + w011 * dx[c010 + 1]
+                               + w100 * dx[c100] + w101 * dx[c100 + 1] + w110 * dx[c110] + w111 * dx[c110 + 1];
+                const float oy = w000 * dy[c000] + w001 * dy[c000 + 1] + w010 * dy[c010] + w011 * dy[c010 + 1]
+                               + w100 * dy[c100] + w101 * dy[c100 + 1] + w110 * dy[c110] + w111 * dy[c110 + 1];
+                const float oz = w000 * dz[c000] + w001 * dz[c000 + 1] + w010 * dz[c010] + w011 * dz[c010 + 1]
+                               + w100 * dz[c100] + w101 * dz[c100 + 1] + w110 * dz[c110] + w111 * dz[c110 + 1];
+
+                x[p] -= ox;
+                y[p] += oy;
+                z[p] += oz;
+            }
+
+            for (const auto& [p, xyz] : outside)
+            {
+                const geo::Vector_t offset = this->serviceOffset(xyz[0], xyz[1], xyz[2]);
+                x[p] = xyz[0] - offset.X();
+                y[p] = xyz[1] + offset.Y();
+                z[p] = xyz[2] + offset.Z();
+            }
+        }
+
+        // Compares the grid with the service at n_points uniformly distributed inside the grid
+        Precision validate(const size_t n_points, const unsigned int seed = 12345) const
+        {
+            Precision precision;
+            if (!_enabled || _dx.empty())
+                return precision;
+
+            std::mt19937 rng(seed);
+            std::array<std::uniform_real_distribution<double>, 3> dist;
+            for (int d = 0; d < 3; ++d)
+                dist[d] = std::uniform_real_distribution<double>(_lo[d], _lo[d] + (_n[d] - 1) * _step[d]);
+
+            double sum = 0.;
+            for (size_t p = 0; p < n_points; ++p)
+            {
+                const double px = dist[0](rng), py = dist[1](rng), pz = dist[2](rng);
+                float x = px, y = py, z = pz;
+                this->map(x, y, z);
+
+                const geo::Vector_t offset = this->serviceOffset(px, py, pz);
+                const double ex = px - offset.X(), ey = py + offset.Y(), ez = pz + offset.Z();
+                const double deviation = std::sqrt((x - ex) * (x - ex) + (y - ey) * (y - ey) + (z - ez) * (z - ez));
+
+                precision.max_deviation = std::max(precision.max_deviation, deviation);
+                sum += deviation;
+            }
+
+            precision.n_points = n_points;
+            precision.mean_deviation = n_points > 0 ? sum / n_points : 0.;
+
+            mf::LogInfo("SCEGrid") << "Grid against service at " << n_points << " random points: mean deviation "
+                                   << precision.mean_deviation << " cm, max deviation " << precision.max_deviation << " cm";
+
+            return precision;
+        }
+
+    private:
+        bool inside(const float x, const float y, const float z) const
+        {
+            const std::array<float, 3> xyz = {x, y, z};
+            for (int d = 0; d < 3; ++d)
+            {
+                const float u = (xyz[d] - _lo[d]) * _inv_step[d];
+                if (!(u >= 0.f && u <= _n[d] - 1))
+                    return false;
+            }
+
+            return true;
+        }
+
+        size_t node(const int i, const int j, const int k) const
+        {
+            return (static_cast<size_t>(i) * _n[1] + j) * _n[2] + k;
+        }
+
+        geo::Vector_t serviceOffset(const double x, const double y, const double z) const
+        {
+            auto const* sce = lar::providerFrom<spacecharge::SpaceChargeService>();
+            return _offsets == Offsets::kSimSpatial ? sce->GetPosOffsets(geo::Point_t(x, y, z)) : sce->GetCalPosOffsets(geo::Point_t(x, y, z));
+        }
+
+        Offsets _offsets = Offsets::kSimSpatial;
+        bool _built = false;
+        bool _enabled = false;
+        std::array<int, 3> _n = {0, 0, 0};
+        std::array<float, 3> _lo = {0.f, 0.f, 0.f};
+        std::array<float, 3> _step = {0.f, 0.f, 0.f};
+        std::array<float, 3> _inv_step = {0.f, 0.f, 0.f};
+        std::vector<float> _dx, _dy, _dz;
+    };
+
+    // As GetSCECorrTrackLength, with all valid trajectory points corrected in one batch through the grid
+    float GetSCECorrTrackLength(const art::Ptr<recob::Track>& trk, const SCEGrid& grid)
+    {
+        std::vector<float> x, y, z;
+        x.reserve(trk->NumberTrajectoryPoints());
+        y.reserve(trk->NumberTrajectoryPoints());
+        z.reserve(trk->NumberTrajectoryPoints());
+
+        for (size_t i = 0; i < trk->NumberTrajectoryPoints(); i++)
+        {
+            if (!trk->HasValidPoint(i))
+                continue;
+
+            const auto point = trk->LocationAtPoint(i);
+            x.push_back(point.X());
+            y.push_back(point.Y());
+            z.push_back(point.Z());
+        }
+
+        grid.map(x.size(), x.data(), y.data(), z.data());
+
+        float SCElength = 0.;
+        for (size_t i = 1; i < x.size(); i++)
+            SCElength += std::sqrt((x[i] - x[i - 1]) * (x[i] - x[i - 1]) + (y[i] - y[i - 1]) * (y[i] - y[i - 1]) + (z[i] - z[i - 1]) * (z[i] - z[i - 1]));
+
+        return SCElength;
+    }
+}
+
+#endif
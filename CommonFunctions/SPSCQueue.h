@@ -0,0 +1,87 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <utility>
+#include <cstddef>
+
+namespace common
+{
+    // Bounded ring buffer for exactly one producer thread and one consumer thread. Items are
+    // moved in and out, and push blocks while the ring is full so a slow consumer holds back
+    // the producer rather than letting memory grow
+    template <typename T>
+    class BoundedSPSCQueue
+    {
+    public:
+        explicit BoundedSPSCQueue(const size_t capacity)
+            : _slots(capacity + 1)
+        {}
+
+        BoundedSPSCQueue(const BoundedSPSCQueue&) = delete;
+        BoundedSPSCQueue& operator=(const BoundedSPSCQueue&) = delete;
+
+        size_t capacity() const { return _slots.size() - 1; }
+
+        bool tryPush(T& item)
+        {
+            const size_t head = _head.load(std::memory_order_relaxed);
+            const size_t next = this->increment(head);
+            if (next == _tail.load(std::memory_order_acquire))
+                return false;
+
+            _slots[head] = std::move(item);
+            _head.store(next, std::memory_order_release);
+            return true;
+        }
+
+        // Returns true if the ring was full and the producer had to wait for space
+        bool push(T&& item)
+        {
+            size_t n_waits = 0;
+            while (!this->tryPush(item))
+                this->backoff(n_waits++);
+
+            return n_waits > 0;
+        }
+
+        bool tryPop(T& item)
+        {
+            const size_t tail = _tail.load(std::memory_order_relaxed);
+            if (tail == _head.load(std::memory_order_acquire))
+                return false;
+
+            item = std::move(_slots[tail]);
+            _tail.store(this->increment(tail), std::memory_order_release);
+            return true;
+        }
+
+        bool empty() const
+        {
+            return _tail.load(std::memory_order_acquire) == _head.load(std::memory_order_acquire);
+        }
+
+        // Spin briefly, then yield, then sleep, so an idle side does not burn a core
+        static void backoff(const size_t n_waits)
+        {
+            if (n_waits < 64)
+                return;
+            else if (n_waits < 256)
+                std::this_thread::yield();
+            else
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+
+    private:
+        size_t increment(const size_t i) const { return i + 1 == _slots.size() ? 0 : i + 1; }
+
+        std::vector<T> _slots;
+        alignas(64) std::atomic<size_t> _head{0};
+        alignas(64) std::atomic<size_t> _tail{0};
+    };
+}
+
+#endif
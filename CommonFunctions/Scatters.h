@@ -4,6 +4,8 @@
 #include "larpandora/LArPandoraInterface/LArPandoraHelper.h"
 #include "larpandora/LArPandoraInterface/LArPandoraGeometry.h"
 
+#include "CommonFunctions/MCParticleGraph.h"
+
 namespace common
 {
     std::vector<art::Ptr<simb::MCParticle>> GetDaughters(const art::Ptr<simb::MCParticle> &particle, const std::map<int, art::Ptr<simb::MCParticle> > &mcParticleMap)
@@ -17,111 +19,165 @@ namespace common
         return daughters;
     }
 
-    void GetNScatters(const art::ValidHandle<std::vector<simb::MCParticle>> &mcp_h, const art::Ptr<simb::MCParticle> &mcParticle, art::Ptr<simb::MCParticle> &mcScatteredParticle, unsigned int &nElastic, unsigned int &nInelastic)
+    std::vector<art::Ptr<simb::MCParticle>> GetDaughters(const art::Ptr<simb::MCParticle> &particle, const MCParticleGraph &graph)
     {
-        mcScatteredParticle = mcParticle;
+        const int index = graph.find(particle);
+        if (index == MCParticleGraph::kNone)
+            return {};
 
-        std::map<int, art::Ptr<simb::MCParticle> > mcParticleMap;
-        for (size_t d = 0; d < mcp_h->size(); d++)
-        {
-            const art::Ptr<simb::MCParticle> mcParticle(mcp_h, d);
-            if (!mcParticleMap.emplace(mcParticle->TrackId(), mcParticle).second)
-                throw cet::exception("::GetNScatters") << " - Found repeated MCParticle with TrackId = " << mcParticle->TrackId() << "." << std::endl;
-        }
+        return graph.daughterPtrs(index);
+    }
+
+    // One step along a scatter chain: counts the elastic scatters among the daughters of the
+    // particle at index and returns its single same-species inelastic daughter, or kNone if it has
+    // none or more than one
+    int GetScatterStep(const MCParticleGraph &graph, const int index, unsigned int &nElastic)
+    {
+        const int pdg = graph.particle(index)->PdgCode();
 
-        art::Ptr<simb::MCParticle> finalStateParticle;
+        int finalState = MCParticleGraph::kNone;
         bool foundInelasticScatter = false;
-        for (const auto &daughter : GetDaughters(mcParticle, mcParticleMap))
+        for (const int daughter : graph.daughters(index))
         {
-            const auto& process = daughter->Process();
+            const Process process = graph.process(daughter);
 
-            if (process == "hadElastic") 
+            if (process == Process::kHadElastic)
             {
                 nElastic++;
             }
-            else if (process.find("Inelastic") != std::string::npos)
+            else if (IsInelastic(process))
             {
-                if (daughter->PdgCode() != mcParticle->PdgCode()) continue;
+                if (graph.particle(daughter)->PdgCode() != pdg) continue;
 
-                if (foundInelasticScatter) 
+                if (foundInelasticScatter)
                 {
                     foundInelasticScatter = false;
 
                     break;
                 }
-                
-                finalStateParticle = daughter;
+
+                finalState = daughter;
                 foundInelasticScatter = true;
             }
         }
 
-        if (foundInelasticScatter)
+        return foundInelasticScatter ? finalState : MCParticleGraph::kNone;
+    }
+
+    // Follows the chain of same-species inelastic scatters from the particle at index, counting the
+    // elastic scatters along it, and returns the index of the last particle of the chain
+    int GetNScatters(const MCParticleGraph &graph, int index, unsigned int &nElastic, unsigned int &nInelastic)
+    {
+        while (true)
         {
+            const int finalState = GetScatterStep(graph, index, nElastic);
+            if (finalState == MCParticleGraph::kNone)
+                return index;
+
             nInelastic++;
-            GetNScatters(mcp_h, finalStateParticle, mcScatteredParticle, nElastic, nInelastic);
+            index = finalState;
         }
     }
 
-    std::string GetEndState(const art::Ptr<simb::MCParticle> &particle, const art::ValidHandle<std::vector<simb::MCParticle>> &mcp_h)
+    void GetNScatters(const MCParticleGraph &graph, const art::Ptr<simb::MCParticle> &mcParticle, art::Ptr<simb::MCParticle> &mcScatteredParticle, unsigned int &nElastic, unsigned int &nInelastic)
     {
-        std::string type = "Other";
-        bool hasPi0 = false;
-        bool hasDecayMuon = false;
-        bool hasDecayMuonNeutrino = false;
+        mcScatteredParticle = mcParticle;
 
-        std::map<int, art::Ptr<simb::MCParticle>> mcParticleMap;
-        for (size_t d = 0; d < mcp_h->size(); d++)
+        const int index = graph.find(mcParticle);
+        if (index != MCParticleGraph::kNone)
+            mcScatteredParticle = graph.particle(GetNScatters(graph, index, nElastic, nInelastic));
+    }
+
+    void GetNScatters(const art::ValidHandle<std::vector<simb::MCParticle>> &mcp_h, const art::Ptr<simb::MCParticle> &mcParticle, art::Ptr<simb::MCParticle> &mcScatteredParticle, unsigned int &nElastic, unsigned int &nInelastic)
+    {
+        MCParticleGraph graph;
+        graph.build(mcp_h);
+        if (graph.nDuplicates() != 0)
+            throw cet::exception("::GetNScatters") << " - Found " << graph.nDuplicates() << " repeated MCParticle TrackIds." << std::endl;
+
+        GetNScatters(graph, mcParticle, mcScatteredParticle, nElastic, nInelastic);
+    }
+
+    enum class EndState
+    {
+        kNone,
+        kDecayToMuon,
+        kPi0ChargeExchange,
+        kInelasticAbsorption,
+        kOther
+    };
+
+    std::string GetEndStateName(const EndState endState)
+    {
+        switch (endState)
         {
-            const art::Ptr<simb::MCParticle> mcParticle(mcp_h, d);
-            mcParticleMap[mcParticle->TrackId()] = mcParticle;
+            case EndState::kNone: return "None";
+            case EndState::kDecayToMuon: return "DecayToMuon";
+            case EndState::kPi0ChargeExchange: return "Pi0ChargeExchange";
+            case EndState::kInelasticAbsorption: return "InelasticAbsorption";
+            default: return "Other";
         }
+    }
 
-        art::Ptr<simb::MCParticle> scatteredParticle = particle;
-        unsigned int nElastic = 0;
-        unsigned int nInelastic = 0;
-        GetNScatters(mcp_h, particle, scatteredParticle, nElastic, nInelastic);
+    // Classifies how the particle at index, taken as the last of its scatter chain, ends
+    EndState GetScatteredEndState(const MCParticleGraph &graph, const int scattered)
+    {
+        bool hasPi0 = false;
+        bool hasDecayMuon = false;
+        bool hasDecayMuonNeutrino = false;
 
-        std::vector<art::Ptr<simb::MCParticle>> products;
-        for (const auto &daughter : GetDaughters(scatteredParticle, mcParticleMap))
+        size_t nProducts = 0;
+        for (const int daughter : graph.daughters(scattered))
         {
-            const auto process = daughter->Process();
+            const Process process = graph.process(daughter);
+            const int pdg = graph.particle(daughter)->PdgCode();
 
-            if (daughter->PdgCode() == 11 && process == "hIoni")
+            if (pdg == 11 && process == Process::kHIoni)
                 continue;
 
-            if (process == "hadElastic")
+            if (process == Process::kHadElastic)
                 continue;
 
-            products.push_back(daughter);
+            nProducts++;
 
-            if (daughter->PdgCode() == 111 && (process == "pi+Inelastic" || process == "pi-Inelastic"))
+            if (pdg == 111 && (process == Process::kPiPlusInelastic || process == Process::kPiMinusInelastic))
                 hasPi0 = true;
 
-            if (daughter->PdgCode() == -13 && process == "Decay")
+            if (pdg == -13 && process == Process::kDecay)
                 hasDecayMuon = true;
 
-            if (daughter->PdgCode() == 14 && process == "Decay")
+            if (pdg == 14 && process == Process::kDecay)
                 hasDecayMuonNeutrino = true;
         }
 
-        if (products.empty())
-        {
-            type = "None";
-        }
-        else if (hasDecayMuon && hasDecayMuonNeutrino && products.size() == 2)
-        {
-            type = "DecayToMuon";
-        }
-        else if (scatteredParticle->EndProcess() == "pi+Inelastic" || scatteredParticle->EndProcess() == "pi-Inelastic")
-        {
-            type = hasPi0 ? "Pi0ChargeExchange" : "InelasticAbsorption";
-        }
-        else
-        {
-            type = "Other";
-        }
+        const Process endProcess = graph.endProcess(scattered);
+        if (nProducts == 0)
+            return EndState::kNone;
+        else if (hasDecayMuon && hasDecayMuonNeutrino && nProducts == 2)
+            return EndState::kDecayToMuon;
+        else if (endProcess == Process::kPiPlusInelastic || endProcess == Process::kPiMinusInelastic)
+            return hasPi0 ? EndState::kPi0ChargeExchange : EndState::kInelasticAbsorption;
+
+        return EndState::kOther;
+    }
+
+    std::string GetEndState(const art::Ptr<simb::MCParticle> &particle, const MCParticleGraph &graph)
+    {
+        const int index = graph.find(particle);
+        if (index == MCParticleGraph::kNone)
+            return GetEndStateName(EndState::kNone);
+
+        unsigned int nElastic = 0;
+        unsigned int nInelastic = 0;
+        return GetEndStateName(GetScatteredEndState(graph, GetNScatters(graph, index, nElastic, nInelastic)));
+    }
+
+    std::string GetEndState(const art::Ptr<simb::MCParticle> &particle, const art::ValidHandle<std::vector<simb::MCParticle>> &mcp_h)
+    {
+        MCParticleGraph graph;
+        graph.build(mcp_h);
 
-        return type;
+        return GetEndState(particle, graph);
     }
 
     std::vector<art::Ptr<simb::MCParticle>> GetPionChain(const art::Ptr<simb::MCParticle> &particle, const std::map<int, art::Ptr<simb::MCParticle>> &mcParticleMap)
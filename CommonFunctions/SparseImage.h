@@ -0,0 +1,97 @@
+#ifndef SPARSEIMAGE_H
+#define SPARSEIMAGE_H
+
+#include "lardataobj/RecoBase/Hit.h"
+
+#include "CommonFunctions/HitTable.h"
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace common
+{
+    // Region image in coordinate form, one entry per occupied pixel with the charge of
+    // every hit landing in it summed; the vectors keep their capacity between events
+    struct SparseImage
+    {
+        int width = 0;
+        int height = 0;
+        std::vector<int64_t> pixel;
+        std::vector<float> charge;
+        std::vector<std::pair<int64_t, float>> entries;
+
+        size_t size() const { return pixel.size(); }
+
+        float occupancy() const
+        {
+            return width > 0 && height > 0 ? static_cast<float>(pixel.size()) / (static_cast<float>(width) * height) : 0.f;
+        }
+
+        void clear()
+        {
+            pixel.clear();
+            charge.clear();
+            entries.clear();
+        }
+    };
+
+    // Bins the hits into a width x height image over the given drift and wire bounds. pixel_index
+    // is aligned with hits and holds each hit's linear pixel (row * width + column), or -1 if
+    // the hit falls outside the image
+    void BuildSparseImage(const EventHitTable& table,
+                          const std::vector<art::Ptr<recob::Hit>>& hits,
+                          const float x_min, const float x_max,
+                          const float z_min, const float z_max,
+                          const int width, const int height,
+                          SparseImage& image,
+                          std::vector<int32_t>& pixel_index)
+    {
+        image.clear();
+        image.width = width;
+        image.height = height;
+        pixel_index.assign(hits.size(), -1);
+
+        const double dx = (x_max - x_min) / width;
+        const double dz = (z_max - z_min) / height;
+
+        image.entries.reserve(hits.size());
+        for (size_t i = 0; i < hits.size(); ++i)
+        {
+            const int row = table.row(hits[i]);
+            if (row < 0)
+                continue;
+
+            const int pixel_x{static_cast<int>(std::floor((table.drift[row] - x_min) / dx))};
+            const int pixel_z{static_cast<int>(std::floor((table.wire[row] - z_min) / dz))};
+
+            if (pixel_x < 0 || pixel_x >= width || pixel_z < 0 || pixel_z >= height)
+                continue;
+
+            const int32_t pixel = pixel_z * width + pixel_x;
+            pixel_index[i] = pixel;
+            image.entries.emplace_back(pixel, table.charge[row]);
+        }
+
+        // Stable so that charge within a pixel is summed in hit order, as the dense scatter does
+        std::stable_sort(image.entries.begin(), image.entries.end(),
+                         [](const auto& a, const auto& b) { return a.first < b.first; });
+
+        for (const auto& [pixel, q] : image.entries)
+        {
+            if (!image.pixel.empty() && image.pixel.back() == pixel)
+            {
+                image.charge.back() += q;
+            }
+            else
+            {
+                image.pixel.push_back(pixel);
+                image.charge.push_back(q);
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,791 @@
+#ifndef TRAININGSAMPLEIO_H
+#define TRAININGSAMPLEIO_H
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <memory>
+#include <iterator>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+#include <thread>
+#include <atomic>
+#include <exception>
+
+#include "CommonFunctions/SPSCQueue.h"
+
+#ifdef TRAINING_SAMPLE_ZSTD
+#include <zstd.h>
+#endif
+
+// Binary training samples, one file per view. Every value is little-endian and the layout is
+//
+//   file header   char[8] "SFSTRAIN", uint32 version, uint32 compression, uint32 view, uint32 reserved
+//   blocks        uint32 raw size, uint32 stored size, stored bytes (zstd frame or raw records)
+//   index         uint64 n records, then per record uint64 block offset, uint32 offset in block, uint32 size
+//   footer        uint64 index offset, char[8] "SFSINDEX"
+//
+// Each job writes one such shard per view plus a text manifest describing them, and a global
+// index (char[8] "SFSGINDX") built over many manifests points at records inside the shards
+// so that nothing is copied when the samples of many jobs are combined.
+//
+// A record is a TrainingSampleHeader followed by n_hits packed TrainingHit entries. The reader
+// and the standalone tools only use the standard library, so this header does not pull in art.
+namespace common
+{
+    enum TrainingSampleCompression : uint32_t
+    {
+        kCompressionNone = 0,
+        kCompressionZstd = 1
+    };
+
+    struct TrainingSampleHeader
+    {
+        uint32_t n_hits = 0;
+        uint32_t n_flags = 0;
+        uint32_t run = 0;
+        uint32_t subrun = 0;
+        uint32_t event = 0;
+        uint32_t height = 0;
+        uint32_t width = 0;
+        float x_vtx = 0.f;
+        float z_vtx = 0.f;
+        float drift_min = 0.f;
+        float drift_max = 0.f;
+        float wire_min = 0.f;
+        float wire_max = 0.f;
+    };
+
+    // One bit per signature in flags, in the order the signature tools are configured
+    struct TrainingHit
+    {
+        float x = 0.f;
+        float z = 0.f;
+        float q = 0.f;
+        uint32_t flags = 0;
+    };
+
+    struct TrainingSample
+    {
+        TrainingSampleHeader header;
+        std::vector<TrainingHit> hits;
+    };
+
+    namespace training_io
+    {
+        constexpr char kFileMagic[8] = {'S', 'F', 'S', 'T', 'R', 'A', 'I', 'N'};
+        constexpr char kIndexMagic[8] = {'S', 'F', 'S', 'I', 'N', 'D', 'E', 'X'};
+        constexpr char kGlobalIndexMagic[8] = {'S', 'F', 'S', 'G', 'I', 'N', 'D', 'X'};
+        constexpr uint32_t kVersion = 1;
+        constexpr size_t kFileHeaderSize = 24;
+        constexpr size_t kBlockHeaderSize = 8;
+        constexpr size_t kFooterSize = 16;
+        constexpr size_t kSampleHeaderSize = 52;
+        constexpr size_t kHitSize = 16;
+        constexpr size_t kIndexEntrySize = 16;
+
+        template <typename T>
+        void Put(std::vector<char>& buffer, T value)
+        {
+            static_assert(std::is_arithmetic<T>::value, "only arithmetic values are serialised");
+            char bytes[sizeof(T)];
+            std::memcpy(bytes, &value, sizeof(T));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            for (size_t i = 0; i < sizeof(T) / 2; ++i)
+                std::swap(bytes[i], bytes[sizeof(T) - 1 - i]);
+#endif
+            buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+        }
+
+        template <typename T>
+        T Get(const char* data)
+        {
+            char bytes[sizeof(T)];
+            std::memcpy(bytes, data, sizeof(T));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            for (size_t i = 0; i < sizeof(T) / 2; ++i)
+                std::swap(bytes[i], bytes[sizeof(T) - 1 - i]);
+#endif
+            T value;
+            std::memcpy(&value, bytes, sizeof(T));
+            return value;
+        }
+
+        inline void PutSample(std::vector<char>& buffer, const TrainingSample& sample)
+        {
+            const TrainingSampleHeader& h = sample.header;
+            Put<uint32_t>(buffer, sample.hits.size());
+            Put(buffer, h.n_flags);
+            Put(buffer, h.run);
+            Put(buffer, h.subrun);
+            Put(buffer, h.event);
+            Put(buffer, h.height);
+            Put(buffer, h.width);
+            Put(buffer, h.x_vtx);
+            Put(buffer, h.z_vtx);
+            Put(buffer, h.drift_min);
+            Put(buffer, h.drift_max);
+            Put(buffer, h.wire_min);
+            Put(buffer, h.wire_max);
+
+            for (const TrainingHit& hit : sample.hits)
+            {
+                Put(buffer, hit.x);
+                Put(buffer, hit.z);
+                Put(buffer, hit.q);
+                Put(buffer, hit.flags);
+            }
+        }
+
+        inline void GetSample(const char* data, const size_t size, TrainingSample& sample)
+        {
+            if (size < kSampleHeaderSize)
+                throw std::runtime_error("TrainingSample: truncated record");
+
+            TrainingSampleHeader& h = sample.header;
+            h.n_hits = Get<uint32_t>(data);
+            h.n_flags = Get<uint32_t>(data + 4);
+            h.run = Get<uint32_t>(data + 8);
+            h.subrun = Get<uint32_t>(data + 12);
+            h.event = Get<uint32_t>(data + 16);
+            h.height = Get<uint32_t>(data + 20);
+            h.width = Get<uint32_t>(data + 24);
+            h.x_vtx = Get<float>(data + 28);
+            h.z_vtx = Get<float>(data + 32);
+            h.drift_min = Get<float>(data + 36);
+            h.drift_max = Get<float>(data + 40);
+            h.wire_min = Get<float>(data + 44);
+            h.wire_max = Get<float>(data + 48);
+
+            if (size != kSampleHeaderSize + static_cast<size_t>(h.n_hits) * kHitSize)
+                throw std::runtime_error("TrainingSample: record size does not match its hit count");
+
+            sample.hits.resize(h.n_hits);
+            const char* hit_data = data + kSampleHeaderSize;
+            for (uint32_t i = 0; i < h.n_hits; ++i, hit_data += kHitSize)
+            {
+                sample.hits[i].x = Get<float>(hit_data);
+                sample.hits[i].z = Get<float>(hit_data + 4);
+                sample.hits[i].q = Get<float>(hit_data + 8);
+                sample.hits[i].flags = Get<uint32_t>(hit_data + 12);
+            }
+        }
+    }
+
+    // Keeps the file open for the whole job and packs records into blocks of about block_size
+    // bytes, so the file sees one write per block rather than one open/format/close per sample
+    class TrainingSampleWriter
+    {
+    public:
+        TrainingSampleWriter(const std::string& filename, const uint32_t view, const bool compress, const size_t block_size = 1 << 20, const int level = 3)
+            : _filename(filename)
+            , _compression(kCompressionNone)
+            , _block_size(block_size)
+            , _level(level)
+        {
+#ifdef TRAINING_SAMPLE_ZSTD
+            if (compress)
+                _compression = kCompressionZstd;
+#else
+            if (compress)
+                throw std::runtime_error("TrainingSampleWriter: built without zstd, compression unavailable");
+#endif
+            _out.open(filename, std::ios::binary | std::ios::trunc);
+            if (!_out.is_open())
+                throw std::runtime_error("TrainingSampleWriter: could not open " + filename);
+
+            std::vector<char> header;
+            header.insert(header.end(), training_io::kFileMagic, training_io::kFileMagic + 8);
+            training_io::Put(header, training_io::kVersion);
+            training_io::Put<uint32_t>(header, _compression);
+            training_io::Put(header, view);
+            training_io::Put<uint32_t>(header, 0);
+            this->writeBytes(header.data(), header.size());
+
+            _block.reserve(_block_size + (1 << 16));
+        }
+
+        TrainingSampleWriter(const TrainingSampleWriter&) = delete;
+        TrainingSampleWriter& operator=(const TrainingSampleWriter&) = delete;
+
+        ~TrainingSampleWriter()
+        {
+            try { this->close(); } catch (...) {}
+        }
+
+        void write(const TrainingSample& sample)
+        {
+            const size_t offset_in_block = _block.size();
+            training_io::PutSample(_block, sample);
+
+            _pending_index.push_back({offset_in_block, _block.size() - offset_in_block});
+            ++_n_records;
+
+            if (_block.size() >= _block_size)
+                this->flushBlock();
+        }
+
+        void close()
+        {
+            if (!_out.is_open())
+                return;
+
+            this->flushBlock();
+
+            const uint64_t index_offset = _position;
+            _index_offset = index_offset;
+            std::vector<char> index;
+            index.reserve(8 + _index.size() * training_io::kIndexEntrySize + training_io::kFooterSize);
+            training_io::Put<uint64_t>(index, _index.size());
+            for (const auto& entry : _index)
+            {
+                training_io::Put(index, entry.block_offset);
+                training_io::Put(index, entry.offset_in_block);
+                training_io::Put(index, entry.size);
+            }
+            training_io::Put(index, index_offset);
+            index.insert(index.end(), training_io::kIndexMagic, training_io::kIndexMagic + 8);
+            this->writeBytes(index.data(), index.size());
+
+            _out.close();
+        }
+
+        const std::string& filename() const { return _filename; }
+        size_t nRecords() const { return _n_records; }
+        uint64_t bytesWritten() const { return _position; }
+        uint64_t indexOffset() const { return _index_offset; }
+
+    private:
+        struct IndexEntry
+        {
+            uint64_t block_offset;
+            uint32_t offset_in_block;
+            uint32_t size;
+        };
+
+        struct PendingEntry
+        {
+            size_t offset_in_block;
+            size_t size;
+        };
+
+        void flushBlock()
+        {
+            if (_block.empty())
+                return;
+
+            const uint64_t block_offset = _position;
+            for (const auto& pending : _pending_index)
+                _index.push_back({block_offset, static_cast<uint32_t>(pending.offset_in_block), static_cast<uint32_t>(pending.size)});
+            _pending_index.clear();
+
+            const char* stored = _block.data();
+            size_t stored_size = _block.size();
+#ifdef TRAINING_SAMPLE_ZSTD
+            if (_compression == kCompressionZstd)
+            {
+                _compressed.resize(ZSTD_compressBound(_block.size()));
+                const size_t result = ZSTD_compress(_compressed.data(), _compressed.size(), _block.data(), _block.size(), _level);
+                if (ZSTD_isError(result))
+                    throw std::runtime_error(std::string("TrainingSampleWriter: zstd compression failed, ") + ZSTD_getErrorName(result));
+
+                stored = _compressed.data();
+                stored_size = result;
+            }
+#endif
+            std::vector<char> block_header;
+            training_io::Put<uint32_t>(block_header, _block.size());
+            training_io::Put<uint32_t>(block_header, stored_size);
+            this->writeBytes(block_header.data(), block_header.size());
+            this->writeBytes(stored, stored_size);
+
+            _block.clear();
+        }
+
+        void writeBytes(const char* data, const size_t size)
+        {
+            _out.write(data, size);
+            if (!_out)
+                throw std::runtime_error("TrainingSampleWriter: write to " + _filename + " failed");
+            _position += size;
+        }
+
+        std::string _filename;
+        std::ofstream _out;
+        uint32_t _compression;
+        size_t _block_size;
+        int _level;
+
+        std::vector<char> _block;
+        std::vector<char> _compressed;
+        std::vector<PendingEntry> _pending_index;
+        std::vector<IndexEntry> _index;
+        uint64_t _position = 0;
+        uint64_t _index_offset = 0;
+        size_t _n_records = 0;
+    };
+
+    // Reads the index from the footer on open and decodes records on request, keeping the
+    // last decompressed block so sequential reads touch each block once
+    class TrainingSampleReader
+    {
+    public:
+        explicit TrainingSampleReader(const std::string& filename)
+            : _filename(filename)
+        {
+            _in.open(filename, std::ios::binary);
+            if (!_in.is_open())
+                throw std::runtime_error("TrainingSampleReader: could not open " + filename);
+
+            char header[training_io::kFileHeaderSize];
+            this->readBytes(0, header, sizeof(header));
+            if (std::memcmp(header, training_io::kFileMagic, 8) != 0)
+                throw std::runtime_error("TrainingSampleReader: " + filename + " is not a training sample file");
+
+            _version = training_io::Get<uint32_t>(header + 8);
+            _compression = training_io::Get<uint32_t>(header + 12);
+            _view = training_io::Get<uint32_t>(header + 16);
+
+            _in.seekg(0, std::ios::end);
+            const uint64_t file_size = _in.tellg();
+            if (file_size < training_io::kFileHeaderSize + training_io::kFooterSize)
+                throw std::runtime_error("TrainingSampleReader: " + filename + " has no index, the writer was not closed");
+
+            char footer[training_io::kFooterSize];
+            this->readBytes(file_size - training_io::kFooterSize, footer, sizeof(footer));
+            if (std::memcmp(footer + 8, training_io::kIndexMagic, 8) != 0)
+                throw std::runtime_error("TrainingSampleReader: " + filename + " has no index, the writer was not closed");
+
+            _index_offset = training_io::Get<uint64_t>(footer);
+
+            char count[8];
+            this->readBytes(_index_offset, count, sizeof(count));
+            const uint64_t n_records = training_io::Get<uint64_t>(count);
+
+            std::vector<char> index(n_records * training_io::kIndexEntrySize);
+            this->readBytes(_index_offset + 8, index.data(), index.size());
+
+            _block_offset.resize(n_records);
+            _offset_in_block.resize(n_records);
+            _size.resize(n_records);
+            for (uint64_t i = 0; i < n_records; ++i)
+            {
+                const char* entry = index.data() + i * training_io::kIndexEntrySize;
+                _block_offset[i] = training_io::Get<uint64_t>(entry);
+                _offset_in_block[i] = training_io::Get<uint32_t>(entry + 8);
+                _size[i] = training_io::Get<uint32_t>(entry + 12);
+            }
+        }
+
+        size_t size() const { return _size.size(); }
+        uint32_t version() const { return _version; }
+        uint32_t compression() const { return _compression; }
+        uint32_t view() const { return _view; }
+        uint64_t dataEnd() const { return _index_offset; }
+        uint64_t blockOffset(const size_t i) const { return _block_offset.at(i); }
+        uint32_t offsetInBlock(const size_t i) const { return _offset_in_block.at(i); }
+        uint32_t recordSize(const size_t i) const { return _size.at(i); }
+        const std::string& filename() const { return _filename; }
+
+        void read(const size_t i, TrainingSample& sample)
+        {
+            if (i >= _size.size())
+                throw std::out_of_range("TrainingSampleReader: record index out of range");
+
+            this->read(_block_offset[i], _offset_in_block[i], _size[i], sample);
+        }
+
+        // Reads a record located through an external index rather than this file's own
+        void read(const uint64_t block_offset, const uint32_t offset_in_block, const uint32_t size, TrainingSample& sample)
+        {
+            this->loadBlock(block_offset);
+            if (static_cast<size_t>(offset_in_block) + size > _block.size())
+                throw std::runtime_error("TrainingSampleReader: record extends past its block in " + _filename);
+
+            training_io::GetSample(_block.data() + offset_in_block, size, sample);
+        }
+
+    private:
+        void loadBlock(const uint64_t block_offset)
+        {
+            if (_loaded_block == static_cast<int64_t>(block_offset))
+                return;
+
+            char block_header[training_io::kBlockHeaderSize];
+            this->readBytes(block_offset, block_header, sizeof(block_header));
+            const uint32_t raw_size = training_io::Get<uint32_t>(block_header);
+            const uint32_t stored_size = training_io::Get<uint32_t>(block_header + 4);
+
+            if (_compression == kCompressionNone)
+            {
+                _block.resize(raw_size);
+                this->readBytes(block_offset + training_io::kBlockHeaderSize, _block.data(), raw_size);
+            }
+            else
+            {
+#ifdef TRAINING_SAMPLE_ZSTD
+                _stored.resize(stored_size);
+                this->readBytes(block_offset + training_io::kBlockHeaderSize, _stored.data(), stored_size);
+                _block.resize(raw_size);
+                const size_t result = ZSTD_decompress(_block.data(), raw_size, _stored.data(), stored_size);
+                if (ZSTD_isError(result) || result != raw_size)
+                    throw std::runtime_error("TrainingSampleReader: corrupt zstd block in " + _filename);
+#else
+                (void)stored_size;
+                throw std::runtime_error("TrainingSampleReader: " + _filename + " is zstd compressed but zstd support was not built");
+#endif
+            }
+
+            _loaded_block = block_offset;
+        }
+
+        void readBytes(const uint64_t offset, char* data, const size_t size)
+        {
+            _in.clear();
+            _in.seekg(offset);
+            _in.read(data, size);
+            if (static_cast<size_t>(_in.gcount()) != size)
+                throw std::runtime_error("TrainingSampleReader: unexpected end of " + _filename);
+        }
+
+        std::string _filename;
+        std::ifstream _in;
+        uint32_t _version = 0;
+        uint32_t _compression = kCompressionNone;
+        uint32_t _view = 0;
+        uint64_t _index_offset = 0;
+
+        std::vector<uint64_t> _block_offset;
+        std::vector<uint32_t> _offset_in_block;
+        std::vector<uint32_t> _size;
+
+        std::vector<char> _block;
+        std::vector<char> _stored;
+        int64_t _loaded_block = -1;
+    };
+
+    // Hands finished samples to a background thread that owns the writers, so compression and
+    // file I/O overlap with event processing. A queue size of zero writes on the calling thread.
+    // Errors raised on the writer thread are rethrown by the next push or by close
+    class AsyncTrainingSampleWriter
+    {
+    public:
+        AsyncTrainingSampleWriter(std::vector<std::unique_ptr<TrainingSampleWriter>> writers, const size_t queue_size)
+            : _writers(std::move(writers))
+            , _queue(std::max<size_t>(1, queue_size))
+            , _asynchronous(queue_size > 0)
+        {
+            if (_asynchronous)
+                _thread = std::thread(&AsyncTrainingSampleWriter::run, this);
+        }
+
+        AsyncTrainingSampleWriter(const AsyncTrainingSampleWriter&) = delete;
+        AsyncTrainingSampleWriter& operator=(const AsyncTrainingSampleWriter&) = delete;
+
+        ~AsyncTrainingSampleWriter()
+        {
+            try { this->close(); } catch (...) {}
+        }
+
+        void push(const uint32_t stream, TrainingSample&& sample)
+        {
+            this->rethrow();
+            if (stream >= _writers.size() || _writers[stream] == nullptr)
+                throw std::out_of_range("AsyncTrainingSampleWriter: no writer for stream " + std::to_string(stream));
+
+            if (!_asynchronous)
+            {
+                _writers[stream]->write(sample);
+                return;
+            }
+
+            Item item;
+            item.stream = stream;
+            item.sample = std::move(sample);
+            if (_queue.push(std::move(item)))
+                ++_n_blocked;
+        }
+
+        // Drains the queue, stops the thread and closes every writer
+        void close()
+        {
+            if (_closed)
+                return;
+            _closed = true;
+
+            if (_thread.joinable())
+            {
+                _done.store(true, std::memory_order_release);
+                _thread.join();
+            }
+
+            for (auto& writer : _writers)
+                if (writer != nullptr)
+                    writer->close();
+
+            this->rethrow();
+        }
+
+        size_t size() const { return _writers.size(); }
+        const TrainingSampleWriter* writer(const size_t stream) const { return _writers.at(stream).get(); }
+        size_t nBlockedPushes() const { return _n_blocked; }
+
+    private:
+        struct Item
+        {
+            uint32_t stream = 0;
+            TrainingSample sample;
+        };
+
+        void run()
+        {
+            Item item;
+            size_t n_idle = 0;
+            while (true)
+            {
+                if (_queue.tryPop(item))
+                {
+                    n_idle = 0;
+                    if (_failed.load(std::memory_order_relaxed))
+                        continue;
+
+                    try {
+                        _writers[item.stream]->write(item.sample);
+                    } catch (...) {
+                        _error = std::current_exception();
+                        _failed.store(true, std::memory_order_release);
+                    }
+                    continue;
+                }
+
+                // Everything pushed before done was set is visible once done is, so an empty queue here is final
+                if (_done.load(std::memory_order_acquire) && _queue.empty())
+                    break;
+
+                BoundedSPSCQueue<Item>::backoff(n_idle++);
+            }
+        }
+
+        void rethrow()
+        {
+            if (_failed.load(std::memory_order_acquire) && _error)
+            {
+                std::exception_ptr error = _error;
+                _error = nullptr;
+                std::rethrow_exception(error);
+            }
+        }
+
+        std::vector<std::unique_ptr<TrainingSampleWriter>> _writers;
+        BoundedSPSCQueue<Item> _queue;
+        bool _asynchronous;
+        bool _closed = false;
+        size_t _n_blocked = 0;
+
+        std::thread _thread;
+        std::atomic<bool> _done{false};
+        std::atomic<bool> _failed{false};
+        std::exception_ptr _error;
+    };
+
+    // One line per shard of a job; shard paths are relative to the manifest's directory
+    struct TrainingShardInfo
+    {
+        std::string file;
+        uint32_t view = 0;
+        uint64_t n_records = 0;
+        uint64_t data_begin = 0;
+        uint64_t data_end = 0;
+        uint64_t file_size = 0;
+    };
+
+    inline void WriteTrainingManifest(const std::string& path, const std::string& job, const std::vector<TrainingShardInfo>& shards)
+    {
+        std::ofstream out(path, std::ios::trunc);
+        if (!out.is_open())
+            throw std::runtime_error("WriteTrainingManifest: could not open " + path);
+
+        out << "# training sample manifest v" << training_io::kVersion << "\n";
+        out << "job " << job << "\n";
+        for (const auto& shard : shards)
+        {
+            out << "shard " << shard.file << " view " << shard.view << " events " << shard.n_records
+                << " data " << shard.data_begin << " " << shard.data_end << " size " << shard.file_size << "\n";
+        }
+
+        if (!out)
+            throw std::runtime_error("WriteTrainingManifest: write to " + path + " failed");
+    }
+
+    inline void ReadTrainingManifest(const std::string& path, std::string& job, std::vector<TrainingShardInfo>& shards)
+    {
+        std::ifstream in(path);
+        if (!in.is_open())
+            throw std::runtime_error("ReadTrainingManifest: could not open " + path);
+
+        const size_t slash = path.find_last_of('/');
+        const std::string directory = slash == std::string::npos ? "" : path.substr(0, slash + 1);
+
+        shards.clear();
+        std::string line;
+        while (std::getline(in, line))
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+
+            std::istringstream fields(line);
+            std::string key;
+            fields >> key;
+            if (key == "job")
+            {
+                fields >> job;
+            }
+            else if (key == "shard")
+            {
+                TrainingShardInfo shard;
+                std::string view_key, events_key, data_key, size_key;
+                fields >> shard.file >> view_key >> shard.view >> events_key >> shard.n_records
+                       >> data_key >> shard.data_begin >> shard.data_end >> size_key >> shard.file_size;
+                if (!fields || view_key != "view" || events_key != "events" || data_key != "data" || size_key != "size")
+                    throw std::runtime_error("ReadTrainingManifest: malformed shard line in " + path);
+
+                shard.file = directory + shard.file;
+                shards.push_back(shard);
+            }
+        }
+    }
+
+    // Records of one view across many shards, read in place through per-shard readers
+    class TrainingSampleIndex
+    {
+    public:
+        struct Entry
+        {
+            uint32_t shard;
+            uint32_t offset_in_block;
+            uint64_t block_offset;
+            uint32_t size;
+        };
+
+        TrainingSampleIndex() = default;
+
+        explicit TrainingSampleIndex(const std::string& filename)
+        {
+            std::ifstream in(filename, std::ios::binary);
+            if (!in.is_open())
+                throw std::runtime_error("TrainingSampleIndex: could not open " + filename);
+
+            std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            size_t pos = 0;
+            auto need = [&](const size_t n) {
+                if (pos + n > data.size())
+                    throw std::runtime_error("TrainingSampleIndex: truncated index " + filename);
+            };
+
+            need(16);
+            if (std::memcmp(data.data(), training_io::kGlobalIndexMagic, 8) != 0)
+                throw std::runtime_error("TrainingSampleIndex: " + filename + " is not a training sample index");
+            _view = training_io::Get<uint32_t>(data.data() + 12);
+            pos = 16;
+
+            need(4);
+            const uint32_t n_shards = training_io::Get<uint32_t>(data.data() + pos);
+            pos += 4;
+            for (uint32_t s = 0; s < n_shards; ++s)
+            {
+                need(4);
+                const uint32_t length = training_io::Get<uint32_t>(data.data() + pos);
+                pos += 4;
+                need(length);
+                _shards.emplace_back(data.data() + pos, length);
+                pos += length;
+            }
+
+            need(8);
+            const uint64_t n_records = training_io::Get<uint64_t>(data.data() + pos);
+            pos += 8;
+            need(n_records * 20);
+            _entries.resize(n_records);
+            for (auto& entry : _entries)
+            {
+                entry.shard = training_io::Get<uint32_t>(data.data() + pos);
+                entry.offset_in_block = training_io::Get<uint32_t>(data.data() + pos + 4);
+                entry.block_offset = training_io::Get<uint64_t>(data.data() + pos + 8);
+                entry.size = training_io::Get<uint32_t>(data.data() + pos + 16);
+                pos += 20;
+            }
+
+            _readers.resize(_shards.size());
+        }
+
+        void addShard(const std::string& shard_file)
+        {
+            TrainingSampleReader reader(shard_file);
+            const uint32_t shard = _shards.size();
+            _shards.push_back(shard_file);
+            _view = reader.view();
+
+            _entries.reserve(_entries.size() + reader.size());
+            for (size_t i = 0; i < reader.size(); ++i)
+                _entries.push_back({shard, reader.offsetInBlock(i), reader.blockOffset(i), reader.recordSize(i)});
+
+            _readers.resize(_shards.size());
+        }
+
+        void write(const std::string& filename) const
+        {
+            std::vector<char> data;
+            data.insert(data.end(), training_io::kGlobalIndexMagic, training_io::kGlobalIndexMagic + 8);
+            training_io::Put(data, training_io::kVersion);
+            training_io::Put(data, _view);
+            training_io::Put<uint32_t>(data, _shards.size());
+            for (const auto& shard : _shards)
+            {
+                training_io::Put<uint32_t>(data, shard.size());
+                data.insert(data.end(), shard.begin(), shard.end());
+            }
+
+            training_io::Put<uint64_t>(data, _entries.size());
+            for (const auto& entry : _entries)
+            {
+                training_io::Put(data, entry.shard);
+                training_io::Put(data, entry.offset_in_block);
+                training_io::Put(data, entry.block_offset);
+                training_io::Put(data, entry.size);
+            }
+
+            std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+            out.write(data.data(), data.size());
+            if (!out)
+                throw std::runtime_error("TrainingSampleIndex: write to " + filename + " failed");
+        }
+
+        size_t size() const { return _entries.size(); }
+        size_t nShards() const { return _shards.size(); }
+        uint32_t view() const { return _view; }
+        const std::string& shard(const size_t s) const { return _shards.at(s); }
+        const Entry& entry(const size_t i) const { return _entries.at(i); }
+
+        void read(const size_t i, TrainingSample& sample)
+        {
+            const Entry& entry = _entries.at(i);
+            auto& reader = _readers[entry.shard];
+            if (reader == nullptr)
+                reader = std::make_unique<TrainingSampleReader>(_shards[entry.shard]);
+
+            reader->read(entry.block_offset, entry.offset_in_block, entry.size, sample);
+        }
+
+    private:
+        uint32_t _view = 0;
+        std::vector<std::string> _shards;
+        std::vector<Entry> _entries;
+        std::vector<std::unique_ptr<TrainingSampleReader>> _readers;
+    };
+}
+
+#endif
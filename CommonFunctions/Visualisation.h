@@ -12,6 +12,8 @@
 #include "lardataobj/AnalysisBase/BackTrackerMatchingData.h"
 
 #include "CommonFunctions/Pandora.h"
+#include "CommonFunctions/HitTable.h"
+#include "CommonFunctions/HitTruthOwners.h"
 
 #include "SignatureTools/SignatureToolBase.h"
 #include "SignatureTools/VertexToolBase.h"
@@ -19,6 +21,7 @@
 #include "TVector3.h"
 #include <vector>
 #include <map>
+#include <set>
 #include <algorithm>
 #include <string>
 
@@ -35,10 +38,11 @@
 
 namespace common
 {
+    // owners holds the max-IDE truth owner of every hit of the collection hit_table was built from
     void visualiseTrueEvent(const art::Event& e,
                     const art::InputTag& mcp_producer,
-                    const art::InputTag& hit_producer,
-                    const art::InputTag& backtrack_tag,
+                    const common::EventHitTable& hit_table,
+                    const common::HitTruthOwners& owners,
                     const std::string& filename)
     {
         auto getLimits = [](const std::vector<float>& wire_coords, const std::vector<float>& drift_coords,
@@ -73,13 +77,9 @@ namespace common
         art::fill_ptr_vector(mc_particle_vector, mc_particle_handle);
         lar_pandora::LArPandoraHelper::BuildMCParticleMap(mc_particle_vector, mc_particle_map);
 
-        art::Handle<std::vector<recob::Hit>> evt_hits;
-        std::vector<art::Ptr<recob::Hit>> hit_vector;
-        
-        if (!e.getByLabel(hit_producer, evt_hits))
+        const std::vector<art::Ptr<recob::Hit>>& hit_vector = hit_table.hits;
+        if (hit_vector.empty())
             throw cet::exception("Common") << "failed to find any hits in event" << std::endl;
-        art::fill_ptr_vector(hit_vector, evt_hits);
-        art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData> assoc_mc_part = art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>(evt_hits, e, backtrack_tag);
 
         std::map<int, int> hits_to_track_map;
         std::map<int, std::vector<art::Ptr<recob::Hit>>> track_to_hits_map;
@@ -87,22 +87,18 @@ namespace common
         for (unsigned int i_h = 0; i_h < hit_vector.size(); i_h++)
         {
             const art::Ptr<recob::Hit> &hit = hit_vector[i_h];
-            const std::vector<art::Ptr<simb::MCParticle>> &matched_mc_part_vector = assoc_mc_part.at(hit.key());
-            auto matched_data_vector = assoc_mc_part.data(hit.key());
-
-            for (unsigned int i_p = 0; i_p < matched_mc_part_vector.size(); i_p++)
-            {
-                const art::Ptr<simb::MCParticle> &matched_mc_part = matched_mc_part_vector.at(i_p);
-                auto matched_data = matched_data_vector.at(i_p);
+            const int owner_id = owners.trackId(hit);
+            if (owner_id == common::kNoTruthOwner)
+                continue;
 
-                if (matched_data->isMaxIDE != 1)
-                    continue;
+            const auto matched_mc_part = mc_particle_map.find(owner_id);
+            if (matched_mc_part == mc_particle_map.end())
+                continue;
 
-                const int track_idx = common::isParticleElectromagnetic(matched_mc_part) ? common::getLeadElectromagneticTrack(matched_mc_part, mc_particle_map) : matched_mc_part->TrackId();
+            const int track_idx = common::isParticleElectromagnetic(matched_mc_part->second) ? common::getLeadElectromagneticTrack(matched_mc_part->second, mc_particle_map) : owner_id;
 
-                hits_to_track_map[hit.key()] = track_idx;
-                track_to_hits_map[track_idx].push_back(hit);
-            }
+            hits_to_track_map[hit.key()] = track_idx;
+            track_to_hits_map[track_idx].push_back(hit);
         }
 
         std::vector<float> true_hits_u_wire;
@@ -115,10 +111,11 @@ namespace common
         std::vector<float> true_hits_w_drift;
         std::vector<float> true_hits_w_owner;
 
-        for (const art::Ptr<recob::Hit> &hit : hit_vector)
+        for (size_t i_h = 0; i_h < hit_vector.size(); ++i_h)
         {
-            common::PandoraView pandora_view = common::GetPandoraView(hit);
-            TVector3 pandora_pos = common::GetPandoraHitPosition(e, hit, pandora_view);
+            const art::Ptr<recob::Hit> &hit = hit_vector[i_h];
+            common::PandoraView pandora_view = hit_table.view[i_h];
+            TVector3 pandora_pos = hit_table.position(i_h);
 
             auto hit_to_track_it = hits_to_track_map.find(hit.key());
             if (hit_to_track_it == hits_to_track_map.end()) {
@@ -275,6 +272,26 @@ namespace common
         delete mg_w;
     }
 
+    void visualiseTrueEvent(const art::Event& e,
+                    const art::InputTag& mcp_producer,
+                    const art::InputTag& hit_producer,
+                    const art::InputTag& backtrack_tag,
+                    const art::InputTag& owner_tag,
+                    const std::string& filename)
+    {
+        common::EventHitTable hit_table;
+        common::BuildEventHitTable(e, hit_producer, nullptr, nullptr, hit_table);
+
+        art::Handle<std::vector<recob::Hit>> hit_h;
+        if (!e.getByLabel(hit_producer, hit_h))
+            throw cet::exception("Common") << "failed to find any hits in event" << std::endl;
+
+        static thread_local common::ProcessInterner interner;
+        common::HitTruthOwners owners;
+        common::LoadHitTruthOwners(e, hit_h, owner_tag, backtrack_tag, interner, owners);
+        visualiseTrueEvent(e, mcp_producer, hit_table, owners, filename);
+    }
+
     /*void visualisePandoraEvent()
     {
         auto getLimits = [](const std::vector<float>& wire_coords, const std::vector<float>& drift_coords,
@@ -638,10 +655,14 @@ namespace common
     }*/
 
 
+    // Each view is cropped to the extent of the signature's hits, padded as before, and only the
+    // background hits inside that window are read from the event's hit index and drawn. A view
+    // without signature hits keeps the extent of every truth-matched hit
     void visualiseSignature(const art::Event& e,
                     const art::InputTag& mcp_producer,
-                    const art::InputTag& hit_producer,
-                    const art::InputTag& backtrack_tag,
+                    const common::EventHitTable& hit_table,
+                    const common::EventHitIndex& hit_index,
+                    const common::HitTruthOwners& owners,
                     const signature::Pattern& patt,
                     const std::string& filename)
     {
@@ -677,215 +698,141 @@ namespace common
         art::fill_ptr_vector(mc_particle_vector, mc_particle_handle);
         lar_pandora::LArPandoraHelper::BuildMCParticleMap(mc_particle_vector, mc_particle_map);
 
-        art::Handle<std::vector<recob::Hit>> evt_hits;
-        std::vector<art::Ptr<recob::Hit>> hit_vector;
-        
-        if (!e.getByLabel(hit_producer, evt_hits))
+        const std::vector<art::Ptr<recob::Hit>>& hit_vector = hit_table.hits;
+        if (hit_vector.empty())
             throw cet::exception("Common") << "failed to find any hits in event" << std::endl;
-        art::fill_ptr_vector(hit_vector, evt_hits);
-        art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData> assoc_mc_part = art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>(evt_hits, e, backtrack_tag);
-
-        std::map<int, int> hits_to_track_map;
-        std::map<int, std::vector<art::Ptr<recob::Hit>>> track_to_hits_map;
 
-        for (unsigned int i_h = 0; i_h < hit_vector.size(); i_h++)
-        {
-            const art::Ptr<recob::Hit> &hit = hit_vector[i_h];
-            const std::vector<art::Ptr<simb::MCParticle>> &matched_mc_part_vector = assoc_mc_part.at(hit.key());
-            auto matched_data_vector = assoc_mc_part.data(hit.key());
-
-            for (unsigned int i_p = 0; i_p < matched_mc_part_vector.size(); i_p++)
-            {
-                const art::Ptr<simb::MCParticle> &matched_mc_part = matched_mc_part_vector.at(i_p);
-                auto matched_data = matched_data_vector.at(i_p);
-
-                if (matched_data->isMaxIDE != 1)
-                    continue;
-
-                const int track_idx = common::isParticleElectromagnetic(matched_mc_part) ? common::getLeadElectromagneticTrack(matched_mc_part, mc_particle_map) : matched_mc_part->TrackId();
-
-                hits_to_track_map[hit.key()] = track_idx;
-                track_to_hits_map[track_idx].push_back(hit);
-            }
+        std::set<int> signature_ids;
+        for (const auto& signature : patt) {
+            for (const auto& mcp : signature.second)
+                signature_ids.insert(mcp->TrackId());
         }
 
-        std::vector<float> true_hits_u_wire;
-        std::vector<float> true_hits_u_drift;
-        std::vector<float> true_hits_u_owner;
-        std::vector<float> true_hits_v_wire;
-        std::vector<float> true_hits_v_drift;
-        std::vector<float> true_hits_v_owner;
-        std::vector<float> true_hits_w_wire;
-        std::vector<float> true_hits_w_drift;
-        std::vector<float> true_hits_w_owner;
-
-        for (const art::Ptr<recob::Hit> &hit : hit_vector)
-        {
-            common::PandoraView pandora_view = common::GetPandoraView(hit);
-            TVector3 pandora_pos = common::GetPandoraHitPosition(e, hit, pandora_view);
+        // By table row, whether the hit is truth-matched and whether its track is in the signature
+        std::vector<uint8_t> row_matched(hit_vector.size(), 0);
+        std::vector<uint8_t> row_is_sig(hit_vector.size(), 0);
 
-            auto hit_to_track_it = hits_to_track_map.find(hit.key());
-            if (hit_to_track_it == hits_to_track_map.end()) {
-                continue; 
-            }
+        std::vector<float> sig_wire[common::N_VIEWS];
+        std::vector<float> sig_drift[common::N_VIEWS];
+        std::vector<float> true_wire[common::N_VIEWS];
+        std::vector<float> true_drift[common::N_VIEWS];
 
-            int owner_trackid = mc_particle_map.at(hit_to_track_it->second)->TrackId();
-
-            if (pandora_view == common::TPC_VIEW_U) {
-                true_hits_u_wire.push_back(pandora_pos.Z());
-                true_hits_u_drift.push_back(pandora_pos.X());
-                true_hits_u_owner.push_back(owner_trackid);
-            }
-            else if (pandora_view == common::TPC_VIEW_V) {
-                true_hits_v_wire.push_back(pandora_pos.Z());
-                true_hits_v_drift.push_back(pandora_pos.X());
-                true_hits_v_owner.push_back(owner_trackid);
-            }
-            else if (pandora_view == common::TPC_VIEW_W) {
-                true_hits_w_wire.push_back(pandora_pos.Z());
-                true_hits_w_drift.push_back(pandora_pos.X());
-                true_hits_w_owner.push_back(owner_trackid);
+        for (size_t i_h = 0; i_h < hit_vector.size(); ++i_h)
+        {
+            const int owner_id = owners.trackId(hit_vector[i_h]);
+            if (owner_id == common::kNoTruthOwner)
+                continue;
+
+            const auto matched_mc_part = mc_particle_map.find(owner_id);
+            if (matched_mc_part == mc_particle_map.end())
+                continue;
+
+            const int track_idx = common::isParticleElectromagnetic(matched_mc_part->second) ? common::getLeadElectromagneticTrack(matched_mc_part->second, mc_particle_map) : owner_id;
+            const int owner_trackid = mc_particle_map.at(track_idx)->TrackId();
+
+            const common::PandoraView view = hit_table.view[i_h];
+            row_matched[i_h] = 1;
+            true_wire[view].push_back(hit_table.wire[i_h]);
+            true_drift[view].push_back(hit_table.drift[i_h]);
+
+            if (signature_ids.count(std::abs(owner_trackid))) {
+                row_is_sig[i_h] = 1;
+                sig_wire[view].push_back(hit_table.wire[i_h]);
+                sig_drift[view].push_back(hit_table.drift[i_h]);
             }
         }
 
         float global_true_drift_min = 1e5, global_true_drift_max = -1e5;
-        float wire_min_u_truth = 1e5, wire_max_u_truth = -1e5;
-        float wire_min_v_truth = 1e5, wire_max_v_truth = -1e5;
-        float wire_min_w_truth = 1e5, wire_max_w_truth = -1e5;
+        float wire_min[common::N_VIEWS] = {1e5, 1e5, 1e5};
+        float wire_max[common::N_VIEWS] = {-1e5, -1e5, -1e5};
         float buffer = 10.0;
 
-        getLimits(true_hits_u_wire, true_hits_u_drift, wire_min_u_truth, wire_max_u_truth, global_true_drift_min, global_true_drift_max);
-        getLimits(true_hits_v_wire, true_hits_v_drift, wire_min_v_truth, wire_max_v_truth, global_true_drift_min, global_true_drift_max);
-        getLimits(true_hits_w_wire, true_hits_w_drift, wire_min_w_truth, wire_max_w_truth, global_true_drift_min, global_true_drift_max);
+        for (int view = common::TPC_VIEW_U; view != common::N_VIEWS; ++view) {
+            if (!sig_wire[view].empty())
+                getLimits(sig_wire[view], sig_drift[view], wire_min[view], wire_max[view], global_true_drift_min, global_true_drift_max);
+            else
+                getLimits(true_wire[view], true_drift[view], wire_min[view], wire_max[view], global_true_drift_min, global_true_drift_max);
+        }
 
         TCanvas* canvas = new TCanvas("canvas", "", 1500, 1500);
         canvas->Divide(1, 3, 0, 0);
 
-        TMultiGraph* mg_u = new TMultiGraph();
-        TMultiGraph* mg_v = new TMultiGraph();
-        TMultiGraph* mg_w = new TMultiGraph();
-
-        mg_u->SetTitle(";Local Drift Coordinate;Local U Wire");
-        mg_v->SetTitle(";Local Drift Coordinate;Local V Wire");
-        mg_w->SetTitle(";Local Drift Coordinate;Local W Wire");
-
-        TGraph* sig_u = new TGraph();
-        sig_u->SetMarkerStyle(20);
-        sig_u->SetMarkerSize(0.5);
-        sig_u->SetMarkerColor(kGreen);
-
-        TGraph* back_u = new TGraph();
-        back_u->SetMarkerStyle(20);
-        back_u->SetMarkerSize(0.5);
-        back_u->SetMarkerColor(kGray);
-        for (size_t i = 0; i < true_hits_u_wire.size(); ++i) {
-            int trackid = std::abs(true_hits_u_owner.at(i));
-
-            bool is_sig = false;
-            for (const auto& signature : patt) {
-                for (const auto& mcp : signature.second) {
-                    if (mcp->TrackId() == trackid){
-                        is_sig = true; 
-                    }
-                }
-            }
-
-            if (is_sig)
-                sig_u->SetPoint(sig_u->GetN(), true_hits_u_drift.at(i), true_hits_u_wire.at(i));
-            else if (!is_sig) 
-                back_u->SetPoint(back_u->GetN(), true_hits_u_drift.at(i), true_hits_u_wire.at(i));
+        const char* titles[common::N_VIEWS] = {";Local Drift Coordinate;Local U Wire", ";Local Drift Coordinate;Local V Wire", ";Local Drift Coordinate;Local W Wire"};
+        TMultiGraph* mg[common::N_VIEWS];
+
+        for (int view = common::TPC_VIEW_U; view != common::N_VIEWS; ++view) {
+            mg[view] = new TMultiGraph();
+            mg[view]->SetTitle(titles[view]);
+
+            TGraph* sig = new TGraph();
+            sig->SetMarkerStyle(20);
+            sig->SetMarkerSize(0.5);
+            sig->SetMarkerColor(kGreen);
+
+            TGraph* back = new TGraph();
+            back->SetMarkerStyle(20);
+            back->SetMarkerSize(0.5);
+            back->SetMarkerColor(kGray);
+
+            hit_index[view].forEachInRect(global_true_drift_min - buffer, global_true_drift_max + buffer, wire_min[view], wire_max[view], [&](const uint32_t row) {
+                if (!row_matched[row])
+                    return;
+
+                if (row_is_sig[row])
+                    sig->SetPoint(sig->GetN(), hit_table.drift[row], hit_table.wire[row]);
+                else
+                    back->SetPoint(back->GetN(), hit_table.drift[row], hit_table.wire[row]);
+            });
+
+            mg[view]->Add(sig); 
+            mg[view]->Add(back);
+
+            canvas->cd(view + 1);
+            mg[view]->Draw("AP");
+            mg[view]->GetXaxis()->SetLimits(global_true_drift_min - buffer, global_true_drift_max + buffer);
+            mg[view]->GetYaxis()->SetRangeUser(wire_min[view], wire_max[view]);
+            mg[view]->GetXaxis()->SetTitleSize(0.05);  
+            mg[view]->GetYaxis()->SetTitleSize(0.05);
         }
 
-        mg_u->Add(sig_u); 
-        mg_u->Add(back_u);
-
-        canvas->cd(1);
-        mg_u->Draw("AP");
-        mg_u->GetXaxis()->SetLimits(global_true_drift_min - buffer, global_true_drift_max + buffer);
-        mg_u->GetYaxis()->SetRangeUser(wire_min_u_truth, wire_max_u_truth);
-        mg_u->GetXaxis()->SetTitleSize(0.05);  
-        mg_u->GetYaxis()->SetTitleSize(0.05);
-
-        TGraph* sig_v = new TGraph();
-        sig_v->SetMarkerStyle(20);
-        sig_v->SetMarkerSize(0.5);
-        sig_v->SetMarkerColor(kGreen);
-
-        TGraph* back_v = new TGraph();
-        back_v->SetMarkerStyle(20);
-        back_v->SetMarkerSize(0.5);
-        back_v->SetMarkerColor(kGray);
-        for (size_t i = 0; i < true_hits_v_wire.size(); ++i) {
-            int trackid = std::abs(true_hits_v_owner.at(i));
-
-            bool is_sig = false;
-            for (const auto& signature : patt) {
-                for (const auto& mcp : signature.second) {
-                    if (mcp->TrackId() == trackid){
-                        is_sig = true; 
-                    }
-                }
-            }
-
-            if (is_sig)
-                sig_v->SetPoint(sig_v->GetN(), true_hits_v_drift.at(i), true_hits_v_wire.at(i));
-            else if (!is_sig) 
-                back_v->SetPoint(back_v->GetN(), true_hits_v_drift.at(i), true_hits_v_wire.at(i));
-        }
-
-        mg_v->Add(sig_v); 
-        mg_v->Add(back_v);
-
-        canvas->cd(2);
-        mg_v->Draw("AP");
-        mg_v->GetXaxis()->SetLimits(global_true_drift_min - buffer, global_true_drift_max + buffer);
-        mg_v->GetYaxis()->SetRangeUser(wire_min_v_truth, wire_max_v_truth);
-        mg_v->GetXaxis()->SetTitleSize(0.05);  
-        mg_v->GetYaxis()->SetTitleSize(0.05);
-
-
-        TGraph* sig_w = new TGraph();
-        sig_w->SetMarkerStyle(20);
-        sig_w->SetMarkerSize(0.5);
-        sig_w->SetMarkerColor(kGreen);
+        canvas->SaveAs((filename + "_signature_hits.png").c_str());
 
-        TGraph* back_w = new TGraph();
-        back_w->SetMarkerStyle(20);
-        back_w->SetMarkerSize(0.5);
-        back_w->SetMarkerColor(kGray);
-        for (size_t i = 0; i < true_hits_w_wire.size(); ++i) {
-            int trackid = std::abs(true_hits_w_owner.at(i));
-
-            bool is_sig = false;
-            for (const auto& signature : patt) {
-                for (const auto& mcp : signature.second) {
-                    if (mcp->TrackId() == trackid){
-                        is_sig = true; 
-                    }
-                }
-            }
+        delete canvas;
+        for (auto* view_mg : mg)
+            delete view_mg;
+    }
 
-            if (is_sig)
-                sig_w->SetPoint(sig_w->GetN(), true_hits_w_drift.at(i), true_hits_w_wire.at(i));
-            else if (!is_sig) 
-                back_w->SetPoint(back_w->GetN(), true_hits_w_drift.at(i), true_hits_w_wire.at(i));
-        }
+    void visualiseSignature(const art::Event& e,
+                    const art::InputTag& mcp_producer,
+                    const common::EventHitTable& hit_table,
+                    const common::HitTruthOwners& owners,
+                    const signature::Pattern& patt,
+                    const std::string& filename)
+    {
+        common::EventHitIndex hit_index;
+        common::BuildEventHitIndex(hit_table, hit_index);
+        visualiseSignature(e, mcp_producer, hit_table, hit_index, owners, patt, filename);
+    }
 
-        mg_w->Add(sig_w); 
-        mg_w->Add(back_w);
+    void visualiseSignature(const art::Event& e,
+                    const art::InputTag& mcp_producer,
+                    const art::InputTag& hit_producer,
+                    const art::InputTag& backtrack_tag,
+                    const art::InputTag& owner_tag,
+                    const signature::Pattern& patt,
+                    const std::string& filename)
+    {
+        common::EventHitTable hit_table;
+        common::BuildEventHitTable(e, hit_producer, nullptr, nullptr, hit_table);
 
-        canvas->cd(3);
-        mg_w->Draw("AP");
-        mg_w->GetXaxis()->SetLimits(global_true_drift_min - buffer, global_true_drift_max + buffer);
-        mg_w->GetYaxis()->SetRangeUser(wire_min_w_truth, wire_max_w_truth);
-        mg_w->GetXaxis()->SetTitleSize(0.05);  
-        mg_w->GetYaxis()->SetTitleSize(0.05);
-        canvas->SaveAs((filename + "_signature_hits.png").c_str());
+        art::Handle<std::vector<recob::Hit>> hit_h;
+        if (!e.getByLabel(hit_producer, hit_h))
+            throw cet::exception("Common") << "failed to find any hits in event" << std::endl;
 
-        delete canvas;
-        delete mg_u;
-        delete mg_v;
-        delete mg_w;
+        static thread_local common::ProcessInterner interner;
+        common::HitTruthOwners owners;
+        common::LoadHitTruthOwners(e, hit_h, owner_tag, backtrack_tag, interner, owners);
+        visualiseSignature(e, mcp_producer, hit_table, owners, patt, filename);
     }
 
 }
@@ -0,0 +1,183 @@
+#ifndef WIREGEOMETRY_H
+#define WIREGEOMETRY_H
+
+#include "larcore/Geometry/Geometry.h"
+#include "larcorealg/Geometry/GeometryCore.h"
+#include "larcorealg/Geometry/PlaneGeo.h"
+#include "larcorealg/Geometry/WireGeo.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include "CommonFunctions/Pandora.h"
+
+#include "TVector3.h"
+
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+#include <cstdint>
+
+namespace common
+{
+    // Per-channel wire centres and Pandora view projections, filled once per run
+    // so hit loops and trajectory scans never go back to the geometry service
+    class WireGeometryLUT
+    {
+    public:
+        struct PlaneInfo
+        {
+            unsigned int n_wires = 0;
+            float coord_first = 0.f;
+            float coord_step = 0.f;
+            bool linear = false;
+            std::vector<raw::ChannelID_t> wire_to_channel;
+            std::vector<float> wire_coord;
+        };
+
+        bool empty() const { return _centre_y.empty(); }
+        size_t nChannels() const { return _centre_y.size(); }
+        size_t nPlanes() const { return _planes.size(); }
+
+        void build(const geo::GeometryCore* geo)
+        {
+            const size_t n_channels = geo->Nchannels();
+            _centre_y.assign(n_channels, 0.f);
+            _centre_z.assign(n_channels, 0.f);
+            _plane.assign(n_channels, 0);
+            _wire.assign(n_channels, 0);
+            for (auto& proj : _proj)
+                proj.assign(n_channels, 0.f);
+
+            _planes.clear();
+            for (geo::PlaneID const& plane_id : geo->IteratePlaneIDs())
+            {
+                if (plane_id.Cryostat != 0 || plane_id.TPC != 0)
+                    continue;
+
+                if (_planes.size() <= plane_id.Plane)
+                    _planes.resize(plane_id.Plane + 1);
+
+                PlaneInfo& info = _planes[plane_id.Plane];
+                info.n_wires = geo->Nwires(plane_id);
+                info.wire_to_channel.resize(info.n_wires);
+                info.wire_coord.resize(info.n_wires);
+
+                for (unsigned int w = 0; w < info.n_wires; ++w)
+                {
+                    const geo::WireID wire_id(plane_id, w);
+                    const raw::ChannelID_t ch = geo->PlaneWireToChannel(wire_id);
+                    const TVector3 xyz = geo->Cryostat(wire_id.Cryostat).TPC(wire_id.TPC).Plane(wire_id.Plane).Wire(wire_id.Wire).GetCenter();
+
+                    info.wire_to_channel[w] = ch;
+                    info.wire_coord[w] = this->planeCoordinate(xyz.Y(), xyz.Z(), plane_id.Plane);
+
+                    if (ch >= n_channels)
+                        continue;
+
+                    _centre_y[ch] = xyz.Y();
+                    _centre_z[ch] = xyz.Z();
+                    _plane[ch] = plane_id.Plane;
+                    _wire[ch] = w;
+                    _proj[TPC_VIEW_U][ch] = YZtoU(xyz.Y(), xyz.Z());
+                    _proj[TPC_VIEW_V][ch] = YZtoV(xyz.Y(), xyz.Z());
+                    _proj[TPC_VIEW_W][ch] = YZtoW(xyz.Y(), xyz.Z());
+                }
+
+                // The wire coordinate is linear in wire number for a regular plane, which gives
+                // an analytic inverse; anything else falls back to a binary search over the wires
+                if (info.n_wires > 1)
+                {
+                    info.coord_first = info.wire_coord.front();
+                    info.coord_step = (info.wire_coord.back() - info.wire_coord.front()) / (info.n_wires - 1);
+
+                    float max_residual = 0.f;
+                    for (unsigned int w = 0; w < info.n_wires; ++w)
+                        max_residual = std::max(max_residual, std::abs(info.wire_coord[w] - (info.coord_first + w * info.coord_step)));
+
+                    info.linear = info.coord_step != 0.f && max_residual < 0.01f * std::abs(info.coord_step);
+                }
+
+                mf::LogInfo("WireGeometryLUT") << "Plane " << plane_id.Plane << ": " << info.n_wires << " wires, step " << info.coord_step << " cm, " << (info.linear ? "analytic" : "tabulated") << " inverse";
+            }
+        }
+
+        float centreY(const raw::ChannelID_t ch) const { return _centre_y[ch]; }
+        float centreZ(const raw::ChannelID_t ch) const { return _centre_z[ch]; }
+        unsigned int plane(const raw::ChannelID_t ch) const { return _plane[ch]; }
+        unsigned int wire(const raw::ChannelID_t ch) const { return _wire[ch]; }
+
+        float projection(const raw::ChannelID_t ch, const PandoraView view) const
+        {
+            return _proj[view][ch];
+        }
+
+        const PlaneInfo& planeInfo(const unsigned int plane) const { return _planes.at(plane); }
+
+        // Coordinate perpendicular to the wires of a plane, using the Pandora wire angles
+        float planeCoordinate(const float y, const float z, const unsigned int plane) const
+        {
+            return plane == 0 ? YZtoU(y, z) : plane == 1 ? YZtoV(y, z) : YZtoW(y, z);
+        }
+
+        // Nearest wire to a point in the y-z plane, or -1 if the point lies more than half a pitch
+        // beyond the last wire, mirroring the exception thrown by GeometryCore::NearestWireID
+        int nearestWire(const float y, const float z, const unsigned int plane) const
+        {
+            if (plane >= _planes.size())
+                return -1;
+
+            const PlaneInfo& info = _planes[plane];
+            if (info.n_wires == 0)
+                return -1;
+
+            const float coord = this->planeCoordinate(y, z, plane);
+
+            if (info.linear)
+            {
+                const float w = (coord - info.coord_first) / info.coord_step;
+                const int nearest = static_cast<int>(std::lround(w));
+                if (nearest < 0 || nearest >= static_cast<int>(info.n_wires))
+                    return -1;
+
+                return nearest;
+            }
+
+            const bool ascending = info.wire_coord.back() >= info.wire_coord.front();
+            auto it = ascending ? std::lower_bound(info.wire_coord.begin(), info.wire_coord.end(), coord)
+                                : std::lower_bound(info.wire_coord.begin(), info.wire_coord.end(), coord, std::greater<float>());
+            int nearest = std::distance(info.wire_coord.begin(), it);
+            if (nearest > 0 && (nearest == static_cast<int>(info.n_wires) || std::abs(info.wire_coord[nearest - 1] - coord) < std::abs(info.wire_coord[nearest] - coord)))
+                nearest -= 1;
+
+            const float half_pitch = info.n_wires > 1 ? 0.5f * std::abs(info.wire_coord[1] - info.wire_coord[0]) : 0.f;
+            if (std::abs(info.wire_coord[nearest] - coord) > half_pitch)
+                return -1;
+
+            return nearest;
+        }
+
+        int nearestChannel(const float y, const float z, const unsigned int plane) const
+        {
+            const int wire = this->nearestWire(y, z, plane);
+            if (wire < 0)
+                return -1;
+
+            return static_cast<int>(_planes[plane].wire_to_channel[wire]);
+        }
+
+        int nearestChannel(const TVector3& point, const unsigned int plane) const
+        {
+            return this->nearestChannel(point.Y(), point.Z(), plane);
+        }
+
+    private:
+        std::vector<float> _centre_y, _centre_z;
+        std::vector<uint8_t> _plane;
+        std::vector<unsigned int> _wire;
+        std::array<std::vector<float>, N_VIEWS> _proj;
+        std::vector<PlaneInfo> _planes;
+    };
+}
+
+#endif
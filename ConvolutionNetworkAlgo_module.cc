@@ -2,11 +2,14 @@
 #include "art/Framework/Core/ModuleMacros.h"
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Principal/Handle.h"
+#include "art/Framework/Principal/Run.h"
+#include "art/Framework/Principal/SubRun.h"
 
 #include "canvas/Persistency/Common/FindManyP.h"
 
 #include "lardataobj/AnalysisBase/BackTrackerMatchingData.h"
 #include "canvas/Utilities/InputTag.h"
+#include "art/Framework/Services/Optional/TFileService.h"
 #include "fhiclcpp/ParameterSet.h"
 #include "larcore/Geometry/Geometry.h"
 #include "lardata/DetectorInfoServices/DetectorPropertiesService.h"
@@ -22,20 +25,37 @@
 #include "CommonFunctions/Region.h"
 #include "CommonFunctions/Types.h"
 #include "CommonFunctions/BadChannels.h"
+#include "CommonFunctions/HitTable.h"
+#include "CommonFunctions/HitIndex.h"
+#include "CommonFunctions/WireGeometry.h"
+#include "CommonFunctions/EventTruthContext.h"
+#include "CommonFunctions/HitTruthOwners.h"
+#include "CommonFunctions/MCParticleGraph.h"
+#include "CommonFunctions/SCEGrid.h"
+#include "CommonFunctions/SparseImage.h"
+#include "CommonFunctions/TrainingSampleIO.h"
 
 #include "art/Utilities/ToolMacros.h"
 #include "art/Utilities/make_tool.h"
 
 #include "SignatureTools/SignatureToolBase.h"
+#include "SignatureTools/SignatureMatcher.h"
 #include "ClarityTools/ClarityToolBase.h"
 
 #include "TDatabasePDG.h"
+#include "TTree.h"
 
 #ifdef ClassDef
 #undef ClassDef
 #endif
 #include <torch/torch.h>
 #include <torch/script.h>
+#if __has_include(<torch/version.h>)
+#include <torch/version.h>
+#endif
+
+#include "tbb/task_arena.h"
+#include "tbb/parallel_invoke.h"
 
 #include <string>
 #include <vector>
@@ -44,6 +64,19 @@
 #include <iostream>
 #include <unordered_map>
 #include <cmath>
+#include <array>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <cctype>
+#include <unistd.h>
+
+// InferenceMode only exists from libtorch 1.9; older releases get the no-grad guard
+#if defined(TORCH_VERSION_MAJOR) && (TORCH_VERSION_MAJOR > 1 || TORCH_VERSION_MINOR >= 9)
+using InferenceGuard = c10::InferenceMode;
+#else
+using InferenceGuard = torch::NoGradGuard;
+#endif
 
 class ConvolutionNetworkAlgo : public art::EDAnalyzer 
 {
@@ -57,48 +90,124 @@ public:
 
     void analyze(art::Event const& e) override;
     void beginJob() override;
+    void beginRun(art::Run const& run) override;
+    void endSubRun(art::SubRun const& subrun) override;
     void endJob() override;
 
     void infer(art::Event const& evt, std::map<int, std::vector<art::Ptr<recob::Hit>>>& classified_hits);
+    void infer(art::Event const& evt, std::map<int, std::vector<art::Ptr<recob::Hit>>>& classified_hits, std::map<int, std::vector<float>>& class_scores);
 
 private:
+    // Network inputs of one event held until its batch is forwarded; only the hit keys are
+    // used once the event has gone, so the results are reported against the stored EventID
+    struct PendingInference
+    {
+        art::EventID id;
+        size_t slot = 0;
+        std::array<std::vector<art::Ptr<recob::Hit>>, common::N_VIEWS> hits;
+        std::array<std::vector<int32_t>, common::N_VIEWS> pixel_index;
+        std::array<torch::Tensor, common::N_VIEWS> input;
+    };
+
+    // Hits grouped by predicted class, with the softmax score of that class and the view aligned to each hit
+    struct InferenceResult
+    {
+        std::map<int, std::vector<art::Ptr<recob::Hit>>> classified_hits;
+        std::map<int, std::vector<float>> class_scores;
+        std::map<int, std::vector<int>> class_views;
+    };
+
     bool _training_mode;
     int _pass;
     
     std::string _training_output_file;
-    std::shared_ptr<torch::jit::script::Module> _model_u, _model_v, _model_w;
+    bool _training_compression;
+    std::string _shard_tag;
+    size_t _training_queue_size;
+    std::unique_ptr<common::AsyncTrainingSampleWriter> _training_writer;
+    std::array<std::shared_ptr<torch::jit::script::Module>, common::N_VIEWS> _models;
 
     int _width, _height;
 
+    int _inference_threads;
+    int _intra_op_threads;
+    std::unique_ptr<tbb::task_arena> _inference_arena;
+
+    bool _run_inference;
+    size_t _inference_batch_size;
+    std::vector<PendingInference> _pending_inference;
+    std::map<size_t, std::pair<size_t, double>> _batch_timing;
+    std::vector<int> _benchmark_batch_sizes;
+    int _benchmark_iterations;
+    torch::Tensor _benchmark_input;
+
+    // One {N+1,1,H,W} image buffer per view, reused between events; slot N is kept for direct infer() calls
+    std::array<torch::Tensor, common::N_VIEWS> _input_buffer;
+
+    // One entry per classified event, with the predicted class and score of each region hit
+    TTree* _inference_tree = nullptr;
+    int _run, _subrun, _event;
+    std::vector<int> _hit_key;
+    std::vector<int> _hit_view;
+    std::vector<int> _hit_class;
+    std::vector<float> _hit_score;
+    std::array<std::vector<common::SparseImage>, common::N_VIEWS> _slot_images;
+    // Fraction of the image a previous event filled above which its input buffer is cleared
+    // with one zero_ rather than by resetting its pixels with index_fill_
+    float _full_clear_occupancy;
+
+    int _warmup_iterations;
+
     float _drift_step;
     float _wire_pitch_u, _wire_pitch_v, _wire_pitch_w;
     std::map<common::PandoraView, float> _wire_pitch;
 
-    art::InputTag _HitProducer, _MCPproducer, _MCTproducer, _BacktrackTag, _PFPproducer, _CLSproducer, _SHRproducer, _SLCproducer, _VTXproducer, _PCAproducer, _TRKproducer, _DeadChannelTag;
+    art::InputTag _HitProducer, _MCPproducer, _MCTproducer, _BacktrackTag, _PFPproducer, _CLSproducer, _SHRproducer, _SLCproducer, _VTXproducer, _PCAproducer, _TRKproducer, _DeadChannelTag, _HitTruthOwnerTag;
 
     std::map<common::PandoraView, std::array<float, 4>> _region_bounds;
     std::vector<art::Ptr<recob::Hit>> _region_hits;
-    std::unique_ptr<art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>> _mcp_bkth_assoc;
+    common::EventHitTable _hit_table;
+    common::EventHitIndex _hit_index;
+    std::vector<uint8_t> _sim_row;
+    std::vector<uint32_t> _region_rows;
+    common::EventTruthContext _truth;
+    common::MCParticleGraph _particle_graph;
 
     calo::CalorimetryAlg* _calo_alg;
 
     std::vector<std::unique_ptr<::signature::SignatureToolBase>> _signatureToolsVec;
+    ::signature::SignatureMatcher _signature_matcher;
 
     bool _veto_bad_channels;
-    std::vector<bool> _bad_channel_mask;
+    common::BadChannelCache _bad_channel_cache;
+    std::shared_ptr<const common::BadChannelSet> _bad_channels;
     const geo::GeometryCore* _geo;
+    common::WireGeometryLUT _wire_lut;
+    common::SCEGrid _sce_grid;
+    double _sce_grid_spacing;
+    int _sce_grid_validation_points;
 
     const bool _filter_clarity;
     std::vector<std::unique_ptr<::claritytools::ClarityToolBase>> _clarityToolsVec;
 
     void initialiseEvent(art::Event const& evt);
     void prepareTrainingSample(art::Event const& evt);
-    void produceTrainingSample(const std::string& filename, const std::vector<float>& feat_vec, bool result);
-    void makeNetworkInput(const art::Event& evt, const std::vector<art::Ptr<recob::Hit>>& hit_list, const common::PandoraView view, torch::Tensor& network_input, std::map<art::Ptr<recob::Hit>,std::pair<int, int>>& calohit_pixel_map);
+    void produceTrainingSample(common::PandoraView view, common::TrainingSample&& sample);
+    std::string getShardTag() const;
+    void closeTrainingShards();
+    void makeNetworkInput(const art::Event& evt, const std::vector<art::Ptr<recob::Hit>>& hit_list, const common::PandoraView view, torch::Tensor& network_input, std::vector<int32_t>& pixel_index, common::SparseImage& image);
     void findRegionBounds(art::Event const& evt, const std::vector<art::Ptr<recob::Hit>>& hits);
     void getNuVertex(art::Event const& evt, std::array<float, 3>& nu_vtx, bool& found_vertex);
     void calculateChargeCentroid(const art::Event& evt, const std::vector<art::Ptr<recob::Hit>>& hits, std::map<common::PandoraView, std::array<float, 2>>& q_cent_map, std::map<common::PandoraView, float>& tot_q_map);
     std::tuple<float, float, float, float> getBoundsForView(common::PandoraView view) const;
+    void loadModels(fhicl::ParameterSet const& pset);
+    std::shared_ptr<torch::jit::script::Module> loadModel(const std::string& model_file, const std::string& label) const;
+    void prepareInference(art::Event const& evt, PendingInference& pending, size_t slot);
+    void runInference(std::vector<PendingInference>& batch, std::vector<InferenceResult>& results);
+    void readbackClasses(const torch::Tensor& output, common::PandoraView view, const std::vector<art::Ptr<recob::Hit>>& hits, const std::vector<int32_t>& pixel_index, InferenceResult& result) const;
+    void flushInference();
+    void writeInference(const art::EventID& id, const InferenceResult& result);
+    void benchmarkInference() const;
 };
 
 ConvolutionNetworkAlgo::ConvolutionNetworkAlgo(fhicl::ParameterSet const& pset)
@@ -106,8 +215,19 @@ ConvolutionNetworkAlgo::ConvolutionNetworkAlgo(fhicl::ParameterSet const& pset)
     , _training_mode{pset.get<bool>("TrainingMode", true)}
     , _pass{pset.get<int>("Pass", 1)}
     , _training_output_file{pset.get<std::string>("TrainingOutputFile", "training_output")}
+    , _training_compression{pset.get<bool>("TrainingCompression", false)}
+    , _shard_tag{pset.get<std::string>("ShardTag", "")}
+    , _training_queue_size{pset.get<size_t>("TrainingQueueSize", 64)}
     , _width{pset.get<int>("ImageWidth", 256)}
     , _height{pset.get<int>("ImageHeight", 256)}
+    , _inference_threads{pset.get<int>("InferenceThreads", 3)}
+    , _intra_op_threads{pset.get<int>("IntraOpThreads", 1)}
+    , _run_inference{pset.get<bool>("RunInference", false)}
+    , _inference_batch_size{pset.get<size_t>("InferenceBatchSize", 1)}
+    , _benchmark_batch_sizes{pset.get<std::vector<int>>("BenchmarkBatchSizes", {})}
+    , _benchmark_iterations{pset.get<int>("BenchmarkIterations", 10)}
+    , _full_clear_occupancy{pset.get<float>("FullClearOccupancy", 0.1)}
+    , _warmup_iterations{pset.get<int>("WarmupIterations", 1)}
     , _drift_step{pset.get<float>("DriftStep", 0.5)}
     , _wire_pitch_u{pset.get<float>("WirePitchU", 0.3)}
     , _wire_pitch_v{pset.get<float>("WirePitchU", 0.3)}
@@ -124,18 +244,26 @@ ConvolutionNetworkAlgo::ConvolutionNetworkAlgo(fhicl::ParameterSet const& pset)
     , _PCAproducer{pset.get<art::InputTag>("PCAproducer", "pandora")}
     , _TRKproducer{pset.get<art::InputTag>("TRKproducer", "pandora")}
     , _DeadChannelTag{pset.get<art::InputTag>("DeadChannelTag")}
+    , _HitTruthOwnerTag{pset.get<art::InputTag>("HitTruthOwnerTag", "")}
+    , _signature_matcher{_MCTproducer}
     , _veto_bad_channels{pset.get<bool>("VetoBadChannels", true)}
+    , _bad_channel_cache{_DeadChannelTag, pset.get<std::vector<std::string>>("BadChannelFiles", {})}
+    , _sce_grid_spacing{pset.get<double>("SCEGridSpacing", 5.0)}
+    , _sce_grid_validation_points{pset.get<int>("SCEGridValidationPoints", 1000)}
     , _filter_clarity{pset.get<bool>("FilterClarity",false)}
 {
     try {
         if (!_training_mode) 
         {
             std::cout << "In testing mode!" << std::endl;
-            std::cout << pset.get<std::string>("ModelFileU") << std::endl;
-            _model_u = torch::jit::load(pset.get<std::string>("ModelFileU"));
-            _model_v = torch::jit::load(pset.get<std::string>("ModelFileV"));
-            _model_w = torch::jit::load(pset.get<std::string>("ModelFileW"));
-            std::cout << "Loaded models" << std::endl;
+
+            // Bound the per-view forward passes to their own arena inside art's TBB scheduler
+            // rather than letting each model spread across every core
+            if (_intra_op_threads > 0)
+                at::set_num_threads(_intra_op_threads);
+            _inference_arena = std::make_unique<tbb::task_arena>(std::max(1, _inference_threads));
+
+            this->loadModels(pset);
         }
     } catch (const c10::Error& e) {
         throw cet::exception("ConvolutionNetworkAlgo") << "Error loading Torch models: " << e.what() << "\n";
@@ -154,8 +282,12 @@ ConvolutionNetworkAlgo::ConvolutionNetworkAlgo(fhicl::ParameterSet const& pset)
     {
         auto const tool_pset = tool_psets.get<fhicl::ParameterSet>(tool_pset_label);
         _signatureToolsVec.push_back(art::make_tool<::signature::SignatureToolBase>(tool_pset));
+        _signature_matcher.add(_signatureToolsVec.back().get());
     }
 
+    if (_signatureToolsVec.size() > 32)
+        throw cet::exception("ConvolutionNetworkAlgo") << "Training hits store signature flags in 32 bits, " << _signatureToolsVec.size() << " signature tools configured";
+
     _geo = art::ServiceHandle<geo::Geometry>()->provider();
 
     if(_filter_clarity){
@@ -165,6 +297,7 @@ ConvolutionNetworkAlgo::ConvolutionNetworkAlgo(fhicl::ParameterSet const& pset)
       {
         auto const tool_pset = claritytool_psets.get<fhicl::ParameterSet>(tool_pset_label);
         _clarityToolsVec.push_back(art::make_tool<::claritytools::ClarityToolBase>(tool_pset));
+        _clarityToolsVec.back()->setBadChannelCache(&_bad_channel_cache);
       }
     }
 
@@ -180,7 +313,17 @@ void ConvolutionNetworkAlgo::analyze(art::Event const& evt)
 
     try {
         if (_training_mode)
+        {
             this->prepareTrainingSample(evt);
+        }
+        else if (_run_inference)
+        {
+            const size_t slot = _pending_inference.size();
+            _pending_inference.emplace_back();
+            this->prepareInference(evt, _pending_inference.back(), slot);
+            if (_pending_inference.size() >= std::max<size_t>(1, _inference_batch_size))
+                this->flushInference();
+        }
     } catch (const c10::Error& e) {
         throw cet::exception("ConvolutionNetworkAlgo") << "Error running algorithm: " << e.what() << "\n";
     }
@@ -189,37 +332,35 @@ void ConvolutionNetworkAlgo::analyze(art::Event const& evt)
 void ConvolutionNetworkAlgo::initialiseEvent(art::Event const& evt)
 {
 
-    if(_veto_bad_channels)
-      common::SetBadChannelMask(evt,_DeadChannelTag,_bad_channel_mask);
+    // The clarity tools always skip dead channels, so the mask is needed for the truth context even without the veto
+    const bool load_bad_channels = _veto_bad_channels || !_clarityToolsVec.empty();
+    _bad_channels = load_bad_channels ? _bad_channel_cache.get(evt) : nullptr;
 
     _region_bounds.clear();
     _region_hits.clear(); 
-    _mcp_bkth_assoc.reset();
+    _hit_table.clear();
 
-    std::vector<art::Ptr<recob::Hit>> evt_hits, all_hits, sim_hits;
-    art::Handle<std::vector<recob::Hit>> hit_handle;
+    std::vector<art::Ptr<recob::Hit>> all_hits, sim_hits;
     
-    if (evt.getByLabel(_HitProducer, hit_handle))
+    // Only the clarity tools use the per-plane matches; the owners alone come from HitTruthOwnerProducer when it ran
+    if (common::BuildEventTruthContext(evt, _HitProducer, _BacktrackTag, _HitTruthOwnerTag, _bad_channels, !_clarityToolsVec.empty(), _truth))
     {
-        art::fill_ptr_vector(evt_hits, hit_handle);
-        _mcp_bkth_assoc = std::make_unique<art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData>>(hit_handle, evt, _BacktrackTag);
+        const std::vector<art::Ptr<recob::Hit>>& evt_hits = _truth.hits;
+        common::BuildEventHitTable(evt_hits, _calo_alg, _veto_bad_channels ? &_bad_channels->mask : nullptr, _hit_table, &_wire_lut);
+        _sim_row.assign(evt_hits.size(), 0);
 
-        for (const auto& hit : evt_hits) 
+        for (size_t i = 0; i < evt_hits.size(); ++i) 
         {
-            if (_veto_bad_channels && _bad_channel_mask[hit->Channel()]) 
+            const auto& hit = evt_hits[i];
+            if (_hit_table.bad_channel[i]) 
                 continue;
             
             all_hits.push_back(hit);
 
-            auto assmcp = _mcp_bkth_assoc->at(hit.key());
-            auto assmdt = _mcp_bkth_assoc->data(hit.key());
-            for (unsigned int ia = 0; ia < assmcp.size(); ++ia)
+            if (_truth.owners.isSimulated(hit))
             {
-                auto amd = assmdt[ia];
-                if (amd->isMaxIDE != 1)
-                    continue;
-                
                 sim_hits.push_back(hit);
+                _sim_row[i] = 1;
             }
         }
     }
@@ -233,19 +374,25 @@ void ConvolutionNetworkAlgo::initialiseEvent(art::Event const& evt)
     if (_region_bounds.empty())
         return;
 
-    for (const auto& hit : sim_hits)
+    // The region of each view is read from the event's hit index, and the rows sorted so that
+    // region hits keep the order of the hit collection
+    common::BuildEventHitIndex(_hit_table, _hit_index);
+
+    _region_rows.clear();
+    for (const auto& view : {common::TPC_VIEW_U, common::TPC_VIEW_V, common::TPC_VIEW_W})
     {
-        common::PandoraView view = common::GetPandoraView(hit);
         auto [drift_min, drift_max, wire_min, wire_max] = this->getBoundsForView(view);
-
-        const auto pos = common::GetPandoraHitPosition(evt, hit, view);
-        float x = pos.X();
-        float z = pos.Z();
-
-        if (x >= drift_min && x <= drift_max && z >= wire_min && z <= wire_max)
-            _region_hits.push_back(hit);
+        _hit_index[view].forEachInRect(drift_min, drift_max, wire_min, wire_max, [this](const uint32_t row) {
+            if (_sim_row[row])
+                _region_rows.push_back(row);
+        });
     }
 
+    std::sort(_region_rows.begin(), _region_rows.end());
+    _region_hits.reserve(_region_rows.size());
+    for (const uint32_t row : _region_rows)
+        _region_hits.push_back(_hit_table.hits[row]);
+
     mf::LogInfo("ConvolutionNetworkAlgo") << "Region Hit size: " << _region_hits.size();
     
 }
@@ -289,12 +436,12 @@ void ConvolutionNetworkAlgo::calculateChargeCentroid(const art::Event& evt, cons
 {
     for (const auto& hit : hits)
     {
-        common::PandoraView view = common::GetPandoraView(hit);
-        const TVector3 pos = common::GetPandoraHitPosition(evt, hit, view);
-        float charge = _calo_alg->ElectronsFromADCArea(hit->Integral(), hit->WireID().Plane);
+        const int row = _hit_table.row(hit);
+        common::PandoraView view = _hit_table.view[row];
+        float charge = _hit_table.charge[row];
 
-        q_cent_map[view][0] += pos.X() * charge;  
-        q_cent_map[view][1] += pos.Z() * charge;  
+        q_cent_map[view][0] += _hit_table.drift[row] * charge;  
+        q_cent_map[view][1] += _hit_table.wire[row] * charge;  
         tot_q_map[view] += charge;
     }
 
@@ -321,20 +468,19 @@ void ConvolutionNetworkAlgo::prepareTrainingSample(art::Event const& evt)
         return; 
     }
 
+    if (!_signatureToolsVec.empty())
+      _particle_graph.build(evt, _MCPproducer);
+
     signature::Pattern patt;
     std::vector<bool> sig_found;
-    for (auto& signatureTool : _signatureToolsVec) {
-      signature::Signature signature; 
-      sig_found.push_back(signatureTool->constructSignature(evt, signature)); 
-      patt.push_back(signature);
-    }
+    _signature_matcher.match(evt, _particle_graph, patt, sig_found);
 
     std::map<common::PandoraView,std::vector<bool>> clarity_results_all_tools;
     for(int view = common::TPC_VIEW_U;view != common::N_VIEWS; view++){ 
       clarity_results_all_tools[static_cast<common::PandoraView>(view)] = std::vector<bool>(_signatureToolsVec.size(),true);
       for(size_t i_s=0;i_s<patt.size();i_s++){
         for (auto &clarityTool : _clarityToolsVec){
-          if(clarityTool->filter(evt,patt.at(i_s),static_cast<common::PandoraView>(view))){
+          if(clarityTool->filter(evt,patt.at(i_s),static_cast<common::PandoraView>(view),_truth)){
           }
           else {
             clarity_results_all_tools[static_cast<common::PandoraView>(view)].at(i_s) = false;
@@ -351,7 +497,7 @@ void ConvolutionNetworkAlgo::prepareTrainingSample(art::Event const& evt)
     std::map<common::PandoraView, std::vector<art::Ptr<recob::Hit>>> region_hits;
     for (const art::Ptr<recob::Hit>& hit : _region_hits) 
     {
-        common::PandoraView view = common::GetPandoraView(hit);
+        common::PandoraView view = _hit_table.view[_hit_table.row(hit)];
         region_hits[view].push_back(hit);
     }
 
@@ -365,22 +511,20 @@ void ConvolutionNetworkAlgo::prepareTrainingSample(art::Event const& evt)
         auto [drift_min, drift_max, wire_min, wire_max] = this->getBoundsForView(view);
         if (x_vtx > (drift_min - 1.f) && x_vtx < (drift_max + 1.f) && z_vtx > (wire_min - 1.f) && z_vtx < (wire_max + 1.f))
         {           
-            unsigned int n_hits = 0;
-            unsigned int n_meta = 0;
-            std::vector<float> feat_vec = { static_cast<float>(n_hits), 
-                                            static_cast<float>(n_flags),
-                                            static_cast<float>(n_meta),
-                                            static_cast<float>(run), 
-                                            static_cast<float>(subrun), 
-                                            static_cast<float>(event),
-                                            static_cast<float>(_height),
-                                            static_cast<float>(_width),
-                                            x_vtx, z_vtx, 
-                                            drift_min, drift_max, 
-                                            wire_min, wire_max };
-
-            n_meta = feat_vec.size();
-            feat_vec[2] = static_cast<float>(n_meta);
+            common::TrainingSample sample;
+            sample.header.n_flags = n_flags;
+            sample.header.run = run;
+            sample.header.subrun = subrun;
+            sample.header.event = event;
+            sample.header.height = _height;
+            sample.header.width = _width;
+            sample.header.x_vtx = x_vtx;
+            sample.header.z_vtx = z_vtx;
+            sample.header.drift_min = drift_min;
+            sample.header.drift_max = drift_max;
+            sample.header.wire_min = wire_min;
+            sample.header.wire_max = wire_max;
+            sample.hits.reserve(evt_view_hits.size());
 
             for (const auto& hit : evt_view_hits)
             {
@@ -388,57 +532,39 @@ void ConvolutionNetworkAlgo::prepareTrainingSample(art::Event const& evt)
                 if (hit_wire.Wire >= art::ServiceHandle<geo::Geometry>()->Nwires(hit_wire)) 
                     continue;
 
-                const auto pos = common::GetPandoraHitPosition(evt, hit, static_cast<common::PandoraView>(view));
-                float x = pos.X();
-                float z = pos.Z();
-                float q = _calo_alg->ElectronsFromADCArea(hit->Integral(), hit->WireID().Plane);
+                const int row = _hit_table.row(hit);
+                float x = _hit_table.drift[row];
+                float z = _hit_table.wire[row];
+                float q = _hit_table.charge[row];
 
-                std::vector<float> signature_flags(n_flags, 0.f);
-                if (_mcp_bkth_assoc != nullptr) 
+                uint32_t signature_flags = 0;
+                const int owner = _truth.owners.trackId(hit);
+                if (owner != common::kNoTruthOwner) 
                 {
-                    const auto& assmcp = _mcp_bkth_assoc->at(hit.key());
-                    const auto& assmdt = _mcp_bkth_assoc->data(hit.key());
-
-                    for (unsigned int ia = 0; ia < assmcp.size(); ++ia) 
+                    size_t sig_ctr = 0;
+                    for (const auto& sig : patt) 
                     {
-                        bool found_flag = false;
-                        if (assmdt[ia]->isMaxIDE == 1) 
+                      // only allow hits to be flagged as belonging to a signature if corresponding clarity filter returned true
+                      if(sig_found.at(sig_ctr) && pass_clarity.at(sig_ctr))
+                      {
+                        for (size_t it = 0; it < sig.second.size(); ++it)
                         {
-                            size_t sig_ctr = 0;
-                            for (const auto& sig : patt) 
-                            {
-                              // only allow hits to be flagged as belonging to a signature if corresponding clarity filter returned true
-                              if(sig_found.at(sig_ctr) && pass_clarity.at(sig_ctr))
-                              {
-                                for (size_t it = 0; it < sig.second.size(); ++it)
-                                {
-                                  if (sig.second[it]->TrackId() == assmcp[ia]->TrackId()) 
-                                  {
-                                    signature_flags.at(sig_ctr) = 1.f;
-                                    found_flag = true;
-                                    break;
-                                  }
-                                }
-                              }
-                              sig_ctr++;
-                            }
-                        }
-
-                        if (found_flag)
+                          if (sig.second[it]->TrackId() == owner) 
+                          {
+                            signature_flags |= (1u << sig_ctr);
                             break;
+                          }
+                        }
+                      }
+                      sig_ctr++;
                     }
                 }
 
-                feat_vec.insert(feat_vec.end(), {x, z, q});
-                feat_vec.insert(feat_vec.end(), signature_flags.begin(), signature_flags.end());
-                ++n_hits;
+                sample.hits.push_back({x, z, q, signature_flags});
             }
 
-            feat_vec[0] = static_cast<float>(n_hits);
-
-            std::string view_string = (view == common::TPC_VIEW_U) ? "U" : (view == common::TPC_VIEW_V) ? "V" : "W";
-            std::string training_filename = _training_output_file + "_" + view_string + ".csv";
-            this->produceTrainingSample(training_filename, feat_vec, true);
+            sample.header.n_hits = sample.hits.size();
+            this->produceTrainingSample(view, std::move(sample));
         }
     }
 }
@@ -458,105 +584,468 @@ void ConvolutionNetworkAlgo::getNuVertex(art::Event const& evt, std::array<float
     found_vertex = true;
 }
 
-void ConvolutionNetworkAlgo::produceTrainingSample(const std::string& filename, const std::vector<float>& feat_vec, bool result)
+void ConvolutionNetworkAlgo::produceTrainingSample(common::PandoraView view, common::TrainingSample&& sample)
 {
-    std::ofstream out_file(filename, std::ios_base::app);
-    if (!out_file.is_open()) {
-        mf::LogError("ConvolutionNetworkAlgo") << "Error: Could not open file " << filename;
-        return;
+    try {
+        _training_writer->push(view, std::move(sample));
+    } catch (const std::exception& e) {
+        throw cet::exception("ConvolutionNetworkAlgo") << "Error writing training sample: " << e.what() << "\n";
     }
+}
 
-    std::string delimiter = ",";
+void ConvolutionNetworkAlgo::infer(art::Event const& evt, std::map<int, std::vector<art::Ptr<recob::Hit>>>& classified_hits) 
+{
+    std::map<int, std::vector<float>> class_scores;
+    this->infer(evt, classified_hits, class_scores);
+}
 
-    for (const float &feature : feat_vec)
-        out_file << feature << delimiter;
+void ConvolutionNetworkAlgo::infer(art::Event const& evt, std::map<int, std::vector<art::Ptr<recob::Hit>>>& classified_hits, std::map<int, std::vector<float>>& class_scores) 
+{
+    std::vector<PendingInference> batch(1);
+    this->prepareInference(evt, batch.front(), std::max<size_t>(1, _inference_batch_size));
+
+    std::vector<InferenceResult> results;
+    this->runInference(batch, results);
+
+    const auto& result = results.front();
+    for (const auto& [class_id, hits] : result.classified_hits)
+    {
+        auto& class_hits = classified_hits[class_id];
+        class_hits.insert(class_hits.end(), hits.begin(), hits.end());
 
-    out_file << static_cast<int>(result) << '\n';
+        const auto& scores = result.class_scores.at(class_id);
+        auto& hit_scores = class_scores[class_id];
+        hit_scores.insert(hit_scores.end(), scores.begin(), scores.end());
+    }
 
-    out_file.close();
+    if (_inference_tree)
+        this->writeInference(evt.id(), result);
 }
 
-void ConvolutionNetworkAlgo::infer(art::Event const& evt, std::map<int, std::vector<art::Ptr<recob::Hit>>>& classified_hits) 
+void ConvolutionNetworkAlgo::prepareInference(art::Event const& evt, PendingInference& pending, size_t slot)
 {
-    std::map<common::PandoraView, std::vector<art::Ptr<recob::Hit>>> region_hits;
+    pending.id = evt.id();
+    pending.slot = slot;
     for (const auto& hit : _region_hits)
-        region_hits[common::GetPandoraView(hit)].push_back(hit);
+        pending.hits[_hit_table.view[_hit_table.row(hit)]].push_back(hit);
 
-    for (const auto& [view, evt_view_hits] : region_hits)
+    auto buildView = [&](const common::PandoraView view) {
+        if (pending.hits[view].empty())
+            return;
+
+        if (!_input_buffer[view].defined())
+        {
+            const size_t n_slots = std::max<size_t>(1, _inference_batch_size) + 1;
+            _input_buffer[view] = torch::zeros({static_cast<int64_t>(n_slots), 1, _height, _width});
+            _slot_images[view].assign(n_slots, common::SparseImage());
+        }
+
+        pending.input[view] = _input_buffer[view].narrow(0, slot, 1);
+        this->makeNetworkInput(evt, pending.hits[view], view, pending.input[view], pending.pixel_index[view], _slot_images[view][slot]);
+    };
+
+    _inference_arena->execute([&] {
+        tbb::parallel_invoke([&] { buildView(common::TPC_VIEW_U); },
+                             [&] { buildView(common::TPC_VIEW_V); },
+                             [&] { buildView(common::TPC_VIEW_W); });
+    });
+
+    if (!_benchmark_batch_sizes.empty() && !_benchmark_input.defined())
     {
-        torch::Tensor network_input;
-        std::map<art::Ptr<recob::Hit>,std::pair<int, int>> calohit_pixel;
-
-        this->makeNetworkInput(evt, evt_view_hits, view, network_input, calohit_pixel);
-
-        torch::Tensor output;
-        if (view == common::TPC_VIEW_U)
-            output = _model_u->forward({network_input}).toTensor();
-        else if (view == common::TPC_VIEW_V)
-            output = _model_v->forward({network_input}).toTensor();
-        else if (view == common::TPC_VIEW_W)
-            output = _model_w->forward({network_input}).toTensor();
-
-        torch::Tensor predicted_classes = torch::argmax(output, 1); 
-        auto classes_accessor{predicted_classes.accessor<int64_t, 4>()};
-        
-        for (size_t i = 0; i < evt_view_hits.size(); ++i)
+        for (const auto& input : pending.input)
         {
-            const auto& hit = evt_view_hits[i];
+            if (input.defined())
+            {
+                _benchmark_input = input.clone();
+                break;
+            }
+        }
+    }
+}
 
-            const auto pixel = calohit_pixel.at(hit);
-            int predicted_class = predicted_classes[0][pixel.first][pixel.second].item<int>();
+void ConvolutionNetworkAlgo::runInference(std::vector<PendingInference>& batch, std::vector<InferenceResult>& results)
+{
+    results.assign(batch.size(), {});
+
+    // Each view stacks the images of every event that has hits in it into one {N,1,H,W} tensor
+    std::array<std::vector<size_t>, common::N_VIEWS> members;
+    std::array<torch::Tensor, common::N_VIEWS> outputs;
 
-            classified_hits[predicted_class].push_back(hit);
+    auto runView = [&](const common::PandoraView view) {
+        std::vector<torch::Tensor> inputs;
+        bool leading_slots = true;
+        for (size_t i = 0; i < batch.size(); ++i)
+        {
+            if (batch[i].hits[view].empty())
+                continue;
+
+            leading_slots = leading_slots && batch[i].slot == members[view].size();
+            members[view].push_back(i);
+            inputs.push_back(batch[i].input[view]);
+        }
+
+        if (inputs.empty())
+            return;
+
+        // When the images already sit in the first slots of the view buffer they are forwarded in place
+        const torch::Tensor input = leading_slots ? _input_buffer[view].narrow(0, 0, inputs.size()) : torch::cat(inputs, 0);
+
+        InferenceGuard guard;
+        outputs[view] = _models[view]->forward({input}).toTensor();
+    };
+
+    _inference_arena->execute([&] {
+        tbb::parallel_invoke([&] { runView(common::TPC_VIEW_U); },
+                             [&] { runView(common::TPC_VIEW_V); },
+                             [&] { runView(common::TPC_VIEW_W); });
+    });
+
+    for (const auto view : {common::TPC_VIEW_U, common::TPC_VIEW_V, common::TPC_VIEW_W})
+    {
+        if (members[view].empty())
+            continue;
+
+        const torch::Tensor output = outputs[view].cpu().to(torch::kFloat);
+
+        for (size_t b = 0; b < members[view].size(); ++b)
+        {
+            const size_t i = members[view][b];
+            this->readbackClasses(output[b], view, batch[i].hits[view], batch[i].pixel_index[view], results[i]);
         }
     }
+}
+
+void ConvolutionNetworkAlgo::readbackClasses(const torch::Tensor& output, const common::PandoraView view, const std::vector<art::Ptr<recob::Hit>>& hits, const std::vector<int32_t>& pixel_index, InferenceResult& result) const
+{
+    // Gather the logits of every hit pixel in one index_select, so the softmax and argmax
+    // run over {C, n_hits} rather than the whole image, and read the answers from one buffer
+    std::vector<int64_t> valid_rows, valid_pixels;
+    valid_rows.reserve(hits.size());
+    valid_pixels.reserve(hits.size());
+    for (size_t h = 0; h < hits.size(); ++h)
+    {
+        if (pixel_index[h] < 0)
+            continue;
+
+        valid_rows.push_back(h);
+        valid_pixels.push_back(pixel_index[h]);
+    }
+
+    if (valid_pixels.empty())
+        return;
+
+    const int64_t n_classes = output.size(0);
+    const torch::Tensor index = torch::from_blob(valid_pixels.data(), {static_cast<int64_t>(valid_pixels.size())}, torch::kLong);
+    const torch::Tensor logits = output.reshape({n_classes, -1}).index_select(1, index);
+    const auto best = torch::softmax(logits, 0).max(0);
 
-    for (const auto& [class_id, hits] : classified_hits)
-        std::cout << "Class " << class_id << " has " << hits.size() << " hits.";
+    const torch::Tensor scores = std::get<0>(best).contiguous();
+    const torch::Tensor classes = std::get<1>(best).contiguous();
+    const auto score_accessor = scores.accessor<float, 1>();
+    const auto class_accessor = classes.accessor<int64_t, 1>();
+
+    for (size_t v = 0; v < valid_rows.size(); ++v)
+    {
+        const int predicted_class = static_cast<int>(class_accessor[v]);
+        result.classified_hits[predicted_class].push_back(hits[valid_rows[v]]);
+        result.class_scores[predicted_class].push_back(score_accessor[v]);
+        result.class_views[predicted_class].push_back(view);
+    }
 }
 
-void ConvolutionNetworkAlgo::makeNetworkInput(const art::Event& evt, const std::vector<art::Ptr<recob::Hit>>& hit_list, const common::PandoraView view, torch::Tensor& network_input, std::map<art::Ptr<recob::Hit>,std::pair<int, int>>& calohit_pixel_map)
+void ConvolutionNetworkAlgo::flushInference()
 {
-    const auto [x_min, x_max, z_min, z_max] = this->getBoundsForView(view);
-    std::vector<double> x_bin_edges(_width + 1);
-    std::vector<double> z_bin_edges(_height + 1);
+    if (_pending_inference.empty())
+        return;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<InferenceResult> results;
+    this->runInference(_pending_inference, results);
+
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    auto& timing = _batch_timing[_pending_inference.size()];
+    timing.first += _pending_inference.size();
+    timing.second += elapsed;
+
+    for (size_t i = 0; i < _pending_inference.size(); ++i)
+        this->writeInference(_pending_inference[i].id, results[i]);
+
+    _pending_inference.clear();
+}
 
-    x_bin_edges[0] = x_min;
-    const double dx = (x_max - x_min) / _width;
+void ConvolutionNetworkAlgo::writeInference(const art::EventID& id, const InferenceResult& result)
+{
+    // Only hit keys are read from the stored pointers, as the event may already be gone
+    _run = id.run();
+    _subrun = id.subRun();
+    _event = id.event();
+
+    _hit_key.clear();
+    _hit_view.clear();
+    _hit_class.clear();
+    _hit_score.clear();
+    for (const auto& [class_id, hits] : result.classified_hits)
+    {
+        const auto& scores = result.class_scores.at(class_id);
+        const auto& views = result.class_views.at(class_id);
+        for (size_t h = 0; h < hits.size(); ++h)
+        {
+            _hit_key.push_back(hits[h].key());
+            _hit_view.push_back(views[h]);
+            _hit_class.push_back(class_id);
+            _hit_score.push_back(scores[h]);
+        }
+    }
+
+    _inference_tree->Fill();
+}
+
+void ConvolutionNetworkAlgo::benchmarkInference() const
+{
+    // Replays one stored image at each requested batch size so the throughput curve
+    // is measured on the same input rather than on whatever the sample happened to contain
+    const torch::Tensor image = _benchmark_input.defined() ? _benchmark_input : torch::zeros({1, 1, _height, _width});
+
+    for (const int batch_size : _benchmark_batch_sizes)
+    {
+        if (batch_size <= 0)
+            continue;
+
+        const torch::Tensor input = image.repeat({batch_size, 1, 1, 1});
+
+        InferenceGuard guard;
+        const auto start = std::chrono::steady_clock::now();
+        for (int it = 0; it < _benchmark_iterations; ++it)
+        {
+            for (const auto view : {common::TPC_VIEW_U, common::TPC_VIEW_V, common::TPC_VIEW_W})
+                _models[view]->forward({input});
+        }
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        mf::LogInfo("ConvolutionNetworkAlgo") << "Benchmark batch size " << batch_size << ": " 
+                                              << (elapsed > 0 ? batch_size * _benchmark_iterations / elapsed : 0.) << " events/s";
+    }
+}
+
+void ConvolutionNetworkAlgo::loadModels(fhicl::ParameterSet const& pset)
+{
+    const std::string model_file_u = pset.get<std::string>("ModelFileU");
+    const std::string model_file_v = pset.get<std::string>("ModelFileV");
+    const std::string model_file_w = pset.get<std::string>("ModelFileW");
+
+    const auto start = std::chrono::steady_clock::now();
+    _inference_arena->execute([&] {
+        tbb::parallel_invoke([&] { _models[common::TPC_VIEW_U] = this->loadModel(model_file_u, "U"); },
+                             [&] { _models[common::TPC_VIEW_V] = this->loadModel(model_file_v, "V"); },
+                             [&] { _models[common::TPC_VIEW_W] = this->loadModel(model_file_w, "W"); });
+    });
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    mf::LogInfo("ConvolutionNetworkAlgo") << "Loaded models in " << elapsed << " s";
+}
+
+std::shared_ptr<torch::jit::script::Module> ConvolutionNetworkAlgo::loadModel(const std::string& model_file, const std::string& label) const
+{
+    const auto load_start = std::chrono::steady_clock::now();
 
-    for (int i = 1; i <= _width; ++i)
-        x_bin_edges[i] = x_bin_edges[i - 1] + dx;
+    auto model = torch::jit::load(model_file);
 
-    z_bin_edges[0] = z_min;
-    const double dz = (z_max - z_min) / _height;
+    const double load_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - load_start).count();
 
-    for (int i = 1; i <= _height; ++i)
-        z_bin_edges[i] = z_bin_edges[i - 1] + dz;
+    // The first forward passes trigger the JIT profiling and specialisation, so pay them here
+    // with the batch shape used in production rather than on the first event
+    const auto warmup_start = std::chrono::steady_clock::now();
+    if (_warmup_iterations > 0)
+    {
+        const torch::Tensor input = torch::zeros({static_cast<int64_t>(std::max<size_t>(1, _inference_batch_size)), 1, _height, _width});
+
+        InferenceGuard guard;
+        for (int it = 0; it < _warmup_iterations; ++it)
+            model->forward({input});
+    }
+    const double warmup_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - warmup_start).count();
+
+    mf::LogInfo("ConvolutionNetworkAlgo") << "Model " << label << " (" << model_file << "): load " << load_time 
+                                          << " s, warm-up " << warmup_time << " s over " << _warmup_iterations << " passes";
+
+    return model;
+}
 
-    network_input = torch::zeros({1, 1, _height, _width});
-    auto accessor = network_input.accessor<float, 4>();
-    for (const auto& hit : hit_list)
+void ConvolutionNetworkAlgo::makeNetworkInput(const art::Event& evt, const std::vector<art::Ptr<recob::Hit>>& hit_list, const common::PandoraView view, torch::Tensor& network_input, std::vector<int32_t>& pixel_index, common::SparseImage& image)
+{
+    const auto [x_min, x_max, z_min, z_max] = this->getBoundsForView(view);
+
+    // The image passed in still holds the pixels written into this input by the previous event
+    if (network_input.defined() && network_input.dim() == 4 && network_input.size(2) == _height && network_input.size(3) == _width)
     {
-        const auto pos = common::GetPandoraHitPosition(evt, hit, static_cast<common::PandoraView>(view));
-        float x = pos.X();
-        float z = pos.Z();
+        torch::Tensor flat = network_input.view({-1});
+        if (image.occupancy() >= _full_clear_occupancy)
+            flat.zero_();
+        else if (image.size() > 0)
+            flat.index_fill_(0, torch::from_blob(image.pixel.data(), {static_cast<int64_t>(image.size())}, torch::kLong), 0.f);
+    }
+    else
+    {
+        network_input = torch::zeros({1, 1, _height, _width});
+    }
 
-        const int pixel_x{static_cast<int>(std::floor((x - x_bin_edges[0]) / dx))};
-        const int pixel_z{static_cast<int>(std::floor((z - z_bin_edges[0]) / dz))};
+    common::BuildSparseImage(_hit_table, hit_list, x_min, x_max, z_min, z_max, _width, _height, image, pixel_index);
+    if (image.size() == 0)
+        return;
+
+    // Pixels are unique after the reduction, so one index_copy writes the whole image
+    const int64_t n_pixels = image.size();
+    network_input.view({-1}).index_copy_(0, torch::from_blob(image.pixel.data(), {n_pixels}, torch::kLong),
+                                         torch::from_blob(image.charge.data(), {n_pixels}, torch::kFloat));
+}
 
-        if (pixel_x >= 0 && pixel_x < _width && pixel_z >= 0 && pixel_z < _height)
+std::string ConvolutionNetworkAlgo::getShardTag() const
+{
+    std::string tag = _shard_tag;
+    if (tag.empty())
+    {
+        if (const char* job_id = std::getenv("JOBSUBJOBID"))
         {
-            float q = _calo_alg->ElectronsFromADCArea(hit->Integral(), hit->WireID().Plane);
-            accessor[0][0][pixel_z][pixel_x] += q;
-            calohit_pixel_map.insert({hit, {pixel_z, pixel_x}});
+            tag = job_id;
+        }
+        else
+        {
+            char host[256] = {0};
+            gethostname(host, sizeof(host) - 1);
+            tag = std::string(host) + "_" + std::to_string(getpid());
         }
     }
+
+    for (char& c : tag)
+    {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-')
+            c = '_';
+    }
+
+    return tag;
+}
+
+void ConvolutionNetworkAlgo::closeTrainingShards()
+{
+    if (_training_writer == nullptr)
+        return;
+
+    try {
+        _training_writer->close();
+    } catch (const std::exception& e) {
+        throw cet::exception("ConvolutionNetworkAlgo") << "Error writing training sample: " << e.what() << "\n";
+    }
+
+    mf::LogInfo("ConvolutionNetworkAlgo") << "Training writer queue was full for " << _training_writer->nBlockedPushes() << " samples";
+
+    std::vector<common::TrainingShardInfo> shards;
+    for (size_t view = 0; view < _training_writer->size(); ++view)
+    {
+        const common::TrainingSampleWriter* writer = _training_writer->writer(view);
+        if (writer == nullptr)
+            continue;
+
+        mf::LogInfo("ConvolutionNetworkAlgo") << "Wrote " << writer->nRecords() << " training samples, " << writer->bytesWritten() << " bytes, to " << writer->filename();
+
+        const std::string& filename = writer->filename();
+        const size_t slash = filename.find_last_of('/');
+
+        common::TrainingShardInfo shard;
+        shard.file = slash == std::string::npos ? filename : filename.substr(slash + 1);
+        shard.view = view;
+        shard.n_records = writer->nRecords();
+        shard.data_begin = common::training_io::kFileHeaderSize;
+        shard.data_end = writer->indexOffset();
+        shard.file_size = writer->bytesWritten();
+        shards.push_back(shard);
+    }
+
+    if (shards.empty())
+        return;
+
+    try {
+        common::WriteTrainingManifest(_training_output_file + "_" + _shard_tag + ".manifest", _shard_tag, shards);
+    } catch (const std::exception& e) {
+        throw cet::exception("ConvolutionNetworkAlgo") << "Error writing training manifest: " << e.what() << "\n";
+    }
 }
 
 void ConvolutionNetworkAlgo::beginJob() 
-{}
+{
+    if (!_training_mode)
+    {
+        if (!_run_inference)
+            return;
+
+        art::ServiceHandle<art::TFileService> tfs;
+        _inference_tree = tfs->make<TTree>("InferenceTree", "Per-hit network classification");
+        _inference_tree->Branch("run", &_run, "run/I");
+        _inference_tree->Branch("subrun", &_subrun, "subrun/I");
+        _inference_tree->Branch("event", &_event, "event/I");
+        _inference_tree->Branch("hit_key", &_hit_key);
+        _inference_tree->Branch("hit_view", &_hit_view);
+        _inference_tree->Branch("hit_class", &_hit_class);
+        _inference_tree->Branch("hit_score", &_hit_score);
+        return;
+    }
+
+    // Each job writes its own shards, so grid outputs can be indexed together without renaming
+    _shard_tag = this->getShardTag();
+    try {
+        std::vector<std::unique_ptr<common::TrainingSampleWriter>> writers;
+        for (const auto view : {common::TPC_VIEW_U, common::TPC_VIEW_V, common::TPC_VIEW_W})
+        {
+            const std::string view_string = (view == common::TPC_VIEW_U) ? "U" : (view == common::TPC_VIEW_V) ? "V" : "W";
+            writers.push_back(std::make_unique<common::TrainingSampleWriter>(_training_output_file + "_" + _shard_tag + "_" + view_string + ".bin", view, _training_compression));
+        }
+
+        _training_writer = std::make_unique<common::AsyncTrainingSampleWriter>(std::move(writers), _training_queue_size);
+    } catch (const std::exception& e) {
+        throw cet::exception("ConvolutionNetworkAlgo") << "Error opening training output: " << e.what() << "\n";
+    }
+}
+
+void ConvolutionNetworkAlgo::beginRun(art::Run const& run) 
+{
+    _wire_lut.build(_geo);
+    for (auto& clarityTool : _clarityToolsVec)
+        clarityTool->setWireGeometry(&_wire_lut);
+
+    // Only the clarity tools move truth positions by space charge, so the grid is sampled for them alone
+    if (!_clarityToolsVec.empty() && !_sce_grid.built())
+    {
+        _sce_grid.build(common::SCEGrid::Offsets::kSimSpatial, _sce_grid_spacing);
+        if (_sce_grid_validation_points > 0)
+            _sce_grid.validate(_sce_grid_validation_points);
+    }
+    for (auto& clarityTool : _clarityToolsVec)
+        clarityTool->setSCEGrid(&_sce_grid);
+}
+
+void ConvolutionNetworkAlgo::endSubRun(art::SubRun const& subrun) 
+{
+    if (!_training_mode)
+        this->flushInference();
+}
 
 void ConvolutionNetworkAlgo::endJob() 
-{}
+{
+    if (_training_mode)
+    {
+        this->closeTrainingShards();
+        return;
+    }
+
+    if (!_benchmark_batch_sizes.empty())
+        this->benchmarkInference();
+
+    this->flushInference();
+
+    for (const auto& [batch_size, timing] : _batch_timing)
+        mf::LogInfo("ConvolutionNetworkAlgo") << "Batch size " << batch_size << ": " << timing.first << " events, " 
+                                              << (timing.second > 0 ? timing.first / timing.second : 0.) << " events/s";
+
+}
 
 DEFINE_ART_MODULE(ConvolutionNetworkAlgo)
@@ -0,0 +1,79 @@
+#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Handle.h"
+
+#include "canvas/Persistency/Common/FindManyP.h"
+#include "canvas/Utilities/InputTag.h"
+#include "fhiclcpp/ParameterSet.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include "lardataobj/AnalysisBase/BackTrackerMatchingData.h"
+#include "lardataobj/RecoBase/Hit.h"
+#include "nusimdata/SimulationBase/MCParticle.h"
+
+#include "CommonFunctions/HitTruthOwners.h"
+#include "CommonFunctions/Processes.h"
+
+#include <vector>
+#include <memory>
+
+// Writes the max-IDE truth owner of every hit of the hit collection as three arrays aligned with
+// the collection, so that later modules of the job, and jobs reading its output, look the owner
+// of a hit up by key rather than walking the backtracker associations again. Readers check through
+// the HitProducer of this module's configuration that the arrays belong to their hit collection
+class HitTruthOwnerProducer : public art::EDProducer
+{
+public:
+    explicit HitTruthOwnerProducer(fhicl::ParameterSet const &pset);
+
+    HitTruthOwnerProducer(HitTruthOwnerProducer const &) = delete;
+    HitTruthOwnerProducer(HitTruthOwnerProducer &&) = delete;
+    HitTruthOwnerProducer &operator=(HitTruthOwnerProducer const &) = delete;
+    HitTruthOwnerProducer &operator=(HitTruthOwnerProducer &&) = delete;
+
+    void produce(art::Event &e) override;
+
+private:
+    art::InputTag _HitProducer, _BacktrackTag;
+
+    common::ProcessInterner _interner;
+    common::HitTruthOwners _owners;
+};
+
+HitTruthOwnerProducer::HitTruthOwnerProducer(fhicl::ParameterSet const &pset)
+    : EDProducer{pset}
+    , _HitProducer{pset.get<art::InputTag>("HitProducer", "gaushit")}
+    , _BacktrackTag{pset.get<art::InputTag>("BacktrackTag", "gaushitTruthMatch")}
+{
+    produces<std::vector<int>>(common::kTruthOwnerTrackIdInstance);
+    produces<std::vector<float>>(common::kTruthOwnerEnergyFractionInstance);
+    produces<std::vector<float>>(common::kTruthOwnerDeltaRayFractionInstance);
+}
+
+void HitTruthOwnerProducer::produce(art::Event &e)
+{
+    _owners.clear();
+
+    art::Handle<std::vector<recob::Hit>> hit_h;
+    if (e.getByLabel(_HitProducer, hit_h))
+    {
+        art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData> assoc(hit_h, e, _BacktrackTag);
+        if (assoc.isValid())
+        {
+            common::FillHitTruthOwners(assoc, _interner, _owners);
+        }
+        else
+        {
+            // Still one entry per hit, so readers see an unsimulated collection rather than a size mismatch
+            mf::LogInfo("HitTruthOwnerProducer") << "No backtracker associations under " << _BacktrackTag.encode();
+            _owners.assign(hit_h->size());
+        }
+    }
+
+    e.put(std::make_unique<std::vector<int>>(std::move(_owners.track_id)), common::kTruthOwnerTrackIdInstance);
+    e.put(std::make_unique<std::vector<float>>(std::move(_owners.energy_fraction)), common::kTruthOwnerEnergyFractionInstance);
+    e.put(std::make_unique<std::vector<float>>(std::move(_owners.delta_ray_fraction)), common::kTruthOwnerDeltaRayFractionInstance);
+}
+
+DEFINE_ART_MODULE(HitTruthOwnerProducer)
@@ -2,6 +2,7 @@
 #include "art/Framework/Core/ModuleMacros.h"
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Principal/Handle.h"
+#include "art/Framework/Principal/Run.h"
 
 #include "canvas/Persistency/Common/FindManyP.h"
 
@@ -22,12 +23,19 @@
 #include "CommonFunctions/Region.h"
 #include "CommonFunctions/Types.h"
 #include "CommonFunctions/Visualisation.h"
+#include "CommonFunctions/HitTable.h"
+#include "CommonFunctions/WireGeometry.h"
+#include "CommonFunctions/BadChannels.h"
+#include "CommonFunctions/EventTruthContext.h"
+#include "CommonFunctions/MCParticleGraph.h"
+#include "CommonFunctions/SCEGrid.h"
 
 #include "art/Utilities/ToolMacros.h"
 #include "art/Utilities/make_tool.h"
 
 #include "SignatureTools/SignatureToolBase.h"
 #include "SignatureTools/VertexToolBase.h"
+#include "SignatureTools/SignatureMatcher.h"
 
 #include "ClarityTools/ClarityToolBase.h"
 
@@ -56,14 +64,20 @@ public:
     PatternClarityFilter &operator=(PatternClarityFilter &&) = delete;
 
     bool filter(art::Event &e) override;
+    bool beginRun(art::Run &run) override;
 
 private:
-    art::InputTag _HitProducer, _MCPproducer, _MCTproducer, _BacktrackTag;
+    art::InputTag _HitProducer, _MCPproducer, _MCTproducer, _BacktrackTag, _DeadChannelTag, _HitTruthOwnerTag;
 
     const geo::GeometryCore* _geo;
+    common::WireGeometryLUT _wire_lut;
+    common::SCEGrid _sce_grid;
+    double _sce_grid_spacing;
+    int _sce_grid_validation_points;
 
-    std::string _bad_channel_file;
-    std::vector<bool> _bad_channel_mask;
+    common::BadChannelCache _bad_channel_cache;
+    common::EventTruthContext _truth;
+    common::MCParticleGraph _particle_graph;
 
     double _patt_hit_comp_thresh;
     int _patt_hit_thresh;
@@ -74,6 +88,7 @@ private:
 
     calo::CalorimetryAlg* _calo_alg;
     std::vector<std::unique_ptr<::signature::SignatureToolBase>> _signatureToolsVec;
+    ::signature::SignatureMatcher _signature_matcher;
     std::vector<std::unique_ptr<::claritytools::ClarityToolBase>> _clarityToolsVec;
     int _targetDetectorPlane;
     bool _quickVisualise;
@@ -89,22 +104,30 @@ PatternClarityFilter::PatternClarityFilter(fhicl::ParameterSet const &pset)
     , _MCPproducer{pset.get<art::InputTag>("MCPproducer", "largeant")}
     , _MCTproducer{pset.get<art::InputTag>("MCTproducer", "generator")}
     , _BacktrackTag{pset.get<art::InputTag>("BacktrackTag", "gaushitTruthMatch")}
+    , _DeadChannelTag{pset.get<art::InputTag>("DeadChannelTag")}
+    , _HitTruthOwnerTag{pset.get<art::InputTag>("HitTruthOwnerTag", "")}
+    , _sce_grid_spacing{pset.get<double>("SCEGridSpacing", 5.0)}
+    , _sce_grid_validation_points{pset.get<int>("SCEGridValidationPoints", 1000)}
+    , _bad_channel_cache{_DeadChannelTag, pset.get<std::vector<std::string>>("BadChannelFiles", {})}
     , _patt_hit_comp_thresh{pset.get<double>("PatternHitCompletenessThreshold", 0.5)}
     , _patt_hit_thresh{pset.get<int>("PatternHitThreshold", 100)}
     , _sig_hit_comp_thresh{pset.get<double>("SignatureHitCompletenessThreshold", 0.1)}
     , _chan_act_reg{pset.get<int>("ChannelActiveRegion", 3)}
     , _hit_exclus_thresh{pset.get<double>("HitExclusivityThreshold", 0.5)}
     , _sig_exclus_thresh{pset.get<double>("SignatureExclusivityThreshold", 0.8)}
+    , _signature_matcher{_MCTproducer}
     , _targetDetectorPlane{pset.get<int>("TargetDetectorPlane", 2)}
     , _quickVisualise{pset.get<bool>("QuickVisualise", true)}
 {
     _calo_alg = new calo::CalorimetryAlg(pset.get<fhicl::ParameterSet>("CaloAlg"));
+    _geo = art::ServiceHandle<geo::Geometry>()->provider();
 
     const fhicl::ParameterSet &tool_psets = pset.get<fhicl::ParameterSet>("SignatureTools");
     for (auto const &tool_pset_label : tool_psets.get_pset_names())
     {
         auto const tool_pset = tool_psets.get<fhicl::ParameterSet>(tool_pset_label);
         _signatureToolsVec.push_back(art::make_tool<::signature::SignatureToolBase>(tool_pset));
+        _signature_matcher.add(_signatureToolsVec.back().get());
     };
 
     const fhicl::ParameterSet &claritytool_psets = pset.get<fhicl::ParameterSet>("ClarityTools");
@@ -112,31 +135,57 @@ PatternClarityFilter::PatternClarityFilter(fhicl::ParameterSet const &pset)
     {
       auto const tool_pset = claritytool_psets.get<fhicl::ParameterSet>(tool_pset_label);
       _clarityToolsVec.push_back(art::make_tool<::claritytools::ClarityToolBase>(tool_pset));
+      _clarityToolsVec.back()->setBadChannelCache(&_bad_channel_cache);
     };
 
 }
 
+bool PatternClarityFilter::beginRun(art::Run &run) 
+{
+    _wire_lut.build(_geo);
+    for (auto &clarityTool : _clarityToolsVec)
+        clarityTool->setWireGeometry(&_wire_lut);
+
+    if (!_sce_grid.built())
+    {
+        _sce_grid.build(common::SCEGrid::Offsets::kSimSpatial, _sce_grid_spacing);
+        if (_sce_grid_validation_points > 0)
+            _sce_grid.validate(_sce_grid_validation_points);
+    }
+    for (auto &clarityTool : _clarityToolsVec)
+        clarityTool->setSCEGrid(&_sce_grid);
+
+    return true;
+}
+
 bool PatternClarityFilter::filter(art::Event &e) 
 {
+    if (!_signatureToolsVec.empty())
+        _particle_graph.build(e, _MCPproducer);
+
     signature::Pattern patt;
-    for (auto &signatureTool : _signatureToolsVec) {
-        signature::Signature signature;
-        if (!signatureTool->constructSignature(e, signature))
-            return false;
+    std::vector<bool> sig_found;
+    if (!_signature_matcher.match(e, _particle_graph, patt, sig_found))
+        return false;
 
-        patt.push_back(signature);
-    }
+    // The visualisation only needs the owners, the clarity tools the per-plane matches as well
+    if (!_clarityToolsVec.empty() || _quickVisualise)
+        common::BuildEventTruthContext(e, _HitProducer, _BacktrackTag, _HitTruthOwnerTag, _bad_channel_cache.get(e), !_clarityToolsVec.empty(), _truth);
 
     for (auto &clarityTool : _clarityToolsVec){
-      std::vector<bool> filter_result =  clarityTool->filter(e, patt, static_cast<common::PandoraView>(_targetDetectorPlane));
+      std::vector<bool> filter_result =  clarityTool->filter(e, patt, static_cast<common::PandoraView>(_targetDetectorPlane), _truth);
       if(std::find(filter_result.begin(),filter_result.end(),false) != filter_result.end()) return false;
     }
 
     if (_quickVisualise)
     {
         std::string filename = "event_" + std::to_string(e.run()) + "_" + std::to_string(e.subRun()) + "_" + std::to_string(e.event());
-        common::visualiseTrueEvent(e, _MCPproducer, _HitProducer, _BacktrackTag, filename);
-        common::visualiseSignature(e, _MCPproducer, _HitProducer, _BacktrackTag, patt, filename);
+        common::EventHitTable hit_table;
+        common::BuildEventHitTable(e, _HitProducer, _calo_alg, nullptr, hit_table, &_wire_lut);
+        common::EventHitIndex hit_index;
+        common::BuildEventHitIndex(hit_table, hit_index);
+        common::visualiseTrueEvent(e, _MCPproducer, hit_table, _truth.owners, filename);
+        common::visualiseSignature(e, _MCPproducer, hit_table, hit_index, _truth.owners, patt, filename);
     }
 
     return true; 
@@ -19,6 +19,16 @@ public:
         , _BacktrackTag{pset.get<art::InputTag>("BacktrackTag", "gaushitTruthMatch")}
     {
         configure(pset);
+        _pattern.type = SignatureKaonShort;
+        _pattern.root_pdgs = {311};
+        _pattern.root_decays = true;
+        _pattern.root_daughters = 1;
+        _pattern.via_pdg = 310;
+        _pattern.via_daughters = 2;
+        _pattern.modes = {
+            {0, {-211, 211}}    // K0 -> KS -> pi+ + pi-
+        };
+        _pattern.assess_rescatters = false;
     }
 
     ~KaonShortSignature() override = default;
@@ -29,9 +39,7 @@ public:
     }
 
     TVector3 findVertex(art::Event const& evt) const override;
-
-protected:
-    void findSignature(art::Event const& evt, Signature& signature, bool& signature_found) override;
+    TVector3 findVertex(art::Event const& evt, const common::MCParticleGraph& graph) const override;
 
 private:
     art::InputTag _HitProducer;
@@ -40,94 +48,23 @@ private:
     art::InputTag _BacktrackTag;
 };
 
-void KaonShortSignature::findSignature(art::Event const& evt, Signature& signature, bool& signature_found)
+TVector3 KaonShortSignature::findVertex(art::Event const& evt) const
 {
-    signature.first = SignatureKaonShort;
-
-    auto const &mcp_h = evt.getValidHandle<std::vector<simb::MCParticle>>(_MCPproducer);
-    std::map<int, art::Ptr<simb::MCParticle>> mcp_map;
-    for (size_t mcp_i = 0; mcp_i < mcp_h->size(); mcp_i++) {
-        const art::Ptr<simb::MCParticle> mcp(mcp_h, mcp_i);
-        mcp_map[mcp->TrackId()] = mcp;
-    }
-
-    auto addDaughterInteractions = [this, &signature, &mcp_map](const art::Ptr<simb::MCParticle>& particle, auto& self) -> void {
-        auto daughters = common::GetDaughters(mcp_map.at(particle->TrackId()), mcp_map);
-        for (const auto& daugh : daughters) {
-            if (daugh->PdgCode() == particle->PdgCode()) {
-                this->fillSignature(daugh, signature); 
-                self(daugh, self); 
-            }
-        }
-    };
-
-    for (const auto &mcp : *mcp_h) 
-    {
-        if (abs(mcp.PdgCode()) == 311 && mcp.Process() == "primary" && mcp.EndProcess() == "Decay" && mcp.NumberDaughters() == 1 && !signature_found) 
-        {
-            auto dtrs = common::GetDaughters(mcp_map.at(mcp.TrackId()), mcp_map);
-            if (dtrs.size() != 1) continue; 
-
-            auto dtr = dtrs.at(0);
-            if (dtr->PdgCode() == 310 && dtr->Process() == "Decay" && dtr->EndProcess() == "Decay" && dtr->NumberDaughters() == 2 && !signature_found)
-            {
-                auto decay = common::GetDaughters(mcp_map.at(dtr->TrackId()), mcp_map);
-                if (decay.size() != 2) continue;
-                
-                std::vector<int> exp_decay = {-211, 211};
-                std::vector<int> fnd_decay;
-                
-                for (const auto &elem : decay) 
-                    fnd_decay.push_back(elem->PdgCode());
-
-                std::sort(exp_decay.begin(), exp_decay.end());
-                std::sort(fnd_decay.begin(), fnd_decay.end());
-
-                if (fnd_decay == exp_decay) 
-                {
-                    bool all_pass = std::all_of(decay.begin(), decay.end(), [&](const auto& elem) {
-                        return this->assessParticle(*elem);
-                    });
-
-                    if (all_pass) 
-                    {
-                        signature_found = true;
-                        for (const auto &elem : decay) 
-                        {
-                            const TParticlePDG* info = TDatabasePDG::Instance()->GetParticle(elem->PdgCode());
-                            if (info->Charge() != 0.0) 
-                            {
-                                this->fillSignature(elem, signature);
-                                addDaughterInteractions(elem, addDaughterInteractions);
-                            }
-                        }
-
-                        break;
-                    }
-                }
-            }
-        }
-    }
+    return this->findVertex(evt, this->particleGraph(evt));
 }
 
-TVector3 KaonShortSignature::findVertex(art::Event const& evt) const
+TVector3 KaonShortSignature::findVertex(art::Event const& evt, const common::MCParticleGraph& graph) const
 {
-    auto const &mcp_h = evt.getValidHandle<std::vector<simb::MCParticle>>(_MCPproducer);
-    std::map<int, art::Ptr<simb::MCParticle>> mcp_map;
-    for (size_t mcp_i = 0; mcp_i < mcp_h->size(); mcp_i++) 
-    {
-        const art::Ptr<simb::MCParticle> mcp(mcp_h, mcp_i);
-        mcp_map[mcp->TrackId()] = mcp;
-    }
-
-    for (const auto &mcp : *mcp_h) 
+    for (size_t i = 0; i < graph.size(); ++i) 
     {
-        if (abs(mcp.PdgCode()) == 311 && mcp.Process() == "primary" && mcp.EndProcess() == "Decay" && mcp.NumberDaughters() == 1) {
-            auto dtrs = common::GetDaughters(mcp_map.at(mcp.TrackId()), mcp_map);
+        const simb::MCParticle& mcp = *graph.particle(i);
+        if (abs(mcp.PdgCode()) == 311 && graph.process(i) == common::Process::kPrimary && graph.endProcess(i) == common::Process::kDecay && mcp.NumberDaughters() == 1) {
+            const auto dtrs = graph.daughters(graph.find(mcp.TrackId()));
             if (dtrs.size() != 1) continue; 
 
-            auto dtr = dtrs.at(0);
-            if (dtr->PdgCode() == 310 && dtr->Process() == "Decay" && dtr->EndProcess() == "Decay" && dtr->NumberDaughters() == 2)
+            const int dtr_index = dtrs[0];
+            auto dtr = graph.particle(dtr_index);
+            if (dtr->PdgCode() == 310 && graph.process(dtr_index) == common::Process::kDecay && graph.endProcess(dtr_index) == common::Process::kDecay && dtr->NumberDaughters() == 2)
             {
                 const TLorentzVector& end_position = dtr->EndPosition();
                 
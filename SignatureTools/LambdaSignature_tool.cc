@@ -16,6 +16,13 @@ public:
         , _MCTproducer{pset.get<art::InputTag>("MCTproducer", "generator")}
     {
         configure(pset);
+        _pattern.type = SignatureLambda;
+        _pattern.root_pdgs = {3122};
+        _pattern.root_decays = true;
+        _pattern.product_processes = {common::Process::kDecay};
+        _pattern.modes = {
+            {0, {-211, 2212}}    // Lambda -> p + pi-
+        };
     }
 
     ~LambdaSignature() override = default;
@@ -26,103 +33,23 @@ public:
     }
 
     TVector3 findVertex(art::Event const& evt) const override;
-
-protected:
-    void findSignature(art::Event const& evt, Signature& signature, bool& signature_found) override;
+    TVector3 findVertex(art::Event const& evt, const common::MCParticleGraph& graph) const override;
 
 private:
     art::InputTag _MCPproducer;
     art::InputTag _MCTproducer;
 };
 
-void LambdaSignature::findSignature(art::Event const& evt, Signature& signature, bool& signature_found)
+TVector3 LambdaSignature::findVertex(art::Event const& evt) const
 {
-    signature.first = SignatureLambda;
-   
-    auto const &mcp_h = evt.getValidHandle<std::vector<simb::MCParticle>>(_MCPproducer);
-    std::map<int, art::Ptr<simb::MCParticle>> mcp_map;
-    for (size_t mcp_i = 0; mcp_i < mcp_h->size(); mcp_i++) {
-        const art::Ptr<simb::MCParticle> mcp(mcp_h, mcp_i);
-        mcp_map[mcp->TrackId()] = mcp;
-    }
-
-    auto addDaughterInteractions = [this, &signature, &mcp_map](const art::Ptr<simb::MCParticle>& particle, auto& self) -> void {
-        auto daughters = common::GetDaughters(mcp_map.at(particle->TrackId()), mcp_map);
-        for (const auto& daugh : daughters) {
-            if (daugh->PdgCode() == particle->PdgCode() && this->assessParticle(*daugh)) {
-                this->fillSignature(daugh, signature); 
-                self(daugh, self); 
-            }
-        }
-    };
-
-    for (const auto &mcp : *mcp_h) 
-    {
-        if (abs(mcp.PdgCode()) == 3122 && mcp.Process() == "primary" && mcp.EndProcess() == "Decay" /*&& mcp.NumberDaughters() == 2*/ && !signature_found) 
-        {
-            auto decay = common::GetDaughters(mcp_map.at(mcp.TrackId()), mcp_map);
-
-            std::vector<art::Ptr<simb::MCParticle>> clean_decay;
-
-            for (const auto& elem : decay) 
-            {
-              if (elem->Process() != "Decay") 
-                continue;
-
-              clean_decay.push_back(elem);
-            }
-
-            decay = clean_decay;
-
-            if (decay.size() != 2) continue; 
-
-            std::vector<int> exp_decay = {-211, 2212};
-            std::vector<int> fnd_decay;
-                
-            for (const auto &elem : decay) 
-                fnd_decay.push_back(elem->PdgCode());
-
-            std::sort(exp_decay.begin(), exp_decay.end());
-            std::sort(fnd_decay.begin(), fnd_decay.end());
-
-            if (fnd_decay == exp_decay) 
-            {
-                bool all_pass = std::all_of(decay.begin(), decay.end(), [&](const auto& elem) {
-                    return this->assessParticle(*elem);
-                });
-
-                if (all_pass) 
-                {
-                    signature_found = true;
-                    for (const auto &elem : decay) 
-                    {
-                        const TParticlePDG* info = TDatabasePDG::Instance()->GetParticle(elem->PdgCode());
-                        if (info->Charge() != 0.0) 
-                        {
-                            this->fillSignature(elem, signature);
-                            addDaughterInteractions(elem, addDaughterInteractions);
-                        }
-                    }
-
-                    break;
-                }
-            }
-        }
-    }
+    return this->findVertex(evt, this->particleGraph(evt));
 }
 
-TVector3 LambdaSignature::findVertex(art::Event const& evt) const
+TVector3 LambdaSignature::findVertex(art::Event const& evt, const common::MCParticleGraph& graph) const
 {
-    auto const &mcp_h = evt.getValidHandle<std::vector<simb::MCParticle>>(_MCPproducer);
-    std::map<int, art::Ptr<simb::MCParticle>> mcp_map;
-    for (size_t mcp_i = 0; mcp_i < mcp_h->size(); mcp_i++) 
-    {
-        const art::Ptr<simb::MCParticle> mcp(mcp_h, mcp_i);
-        mcp_map[mcp->TrackId()] = mcp;
-    }
-
-    for (const auto &mcp : *mcp_h) {
-        if (abs(mcp.PdgCode()) == 3122 && mcp.Process() == "primary" && mcp.EndProcess() == "Decay" && mcp.NumberDaughters() == 2) 
+    for (size_t i = 0; i < graph.size(); ++i) {
+        const simb::MCParticle& mcp = *graph.particle(i);
+        if (abs(mcp.PdgCode()) == 3122 && graph.process(i) == common::Process::kPrimary && graph.endProcess(i) == common::Process::kDecay && mcp.NumberDaughters() == 2) 
         {
             const TLorentzVector& end_position = mcp.EndPosition();
             return TVector3(end_position.X(), end_position.Y(), end_position.Z());
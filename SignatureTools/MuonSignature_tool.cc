@@ -13,6 +13,9 @@ public:
         : _MCPproducer{pset.get<art::InputTag>("MCPproducer", "largeant")}
     {
         configure(pset); 
+        _pattern.type = SignaturePrimaryMuon;
+        _pattern.root_pdgs = {13};
+        _pattern.fill_root = true;
     }
 
     ~MuonSignature() override = default;
@@ -22,33 +25,10 @@ public:
         SignatureToolBase::configure(pset);
     }
 
-protected:
-    void findSignature(art::Event const& evt, Signature& signature, bool& signature_found) override;
-
 private:
     art::InputTag _MCPproducer;
 };
 
-void MuonSignature::findSignature(art::Event const& evt, Signature& signature, bool& signature_found)
-{
-    signature.first = SignaturePrimaryMuon;
-
-    auto const &mcp_h = evt.getValidHandle<std::vector<simb::MCParticle>>(_MCPproducer);
-    std::vector<art::Ptr<simb::MCParticle>> mcp_vec;
-    art::fill_ptr_vector(mcp_vec, mcp_h);
-
-    for (const auto& mcp : mcp_vec) 
-    {
-        if (std::abs(mcp->PdgCode()) == 13 && mcp->Process() == "primary" && this->assessParticle(*mcp)) 
-        {
-            signature_found = true;
-            this->fillSignature(mcp, signature);
-        
-            break;
-        }
-    }
-}
-
 DEFINE_ART_CLASS_TOOL(MuonSignature)
 
 }
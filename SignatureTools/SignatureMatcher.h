@@ -0,0 +1,90 @@
+#ifndef SIGNATURE_MATCHER_H
+#define SIGNATURE_MATCHER_H
+
+#include "art/Framework/Principal/Event.h"
+#include "canvas/Utilities/InputTag.h"
+#include "nusimdata/SimulationBase/MCTruth.h"
+
+#include "CommonFunctions/MCParticleGraph.h"
+#include "SignatureTools/SignatureToolBase.h"
+
+#include <vector>
+#include <unordered_map>
+#include <cstdlib>
+
+namespace signature
+{
+
+// Evaluates the decay patterns of several signature tools in one pass over the primaries of the
+// event. Tools are indexed by the |PDG| of their pattern roots, so each primary is only offered
+// to the tools that can start from it, and each tool keeps the first root that matches, as
+// constructSignature does for a single tool
+class SignatureMatcher
+{
+public:
+    explicit SignatureMatcher(const art::InputTag& mct_tag)
+        : _MCTproducer{mct_tag}
+    {
+    }
+
+    void add(const SignatureToolBase* tool)
+    {
+        const size_t index = _tools.size();
+        _tools.push_back(tool);
+        for (const int pdg : tool->decayPattern().root_pdgs)
+            _tools_by_pdg[std::abs(pdg)].push_back(index);
+    }
+
+    size_t size() const { return _tools.size(); }
+
+    // Fills one signature per tool, in the order the tools were added, and returns true if every
+    // signature was found. Signatures not found are left invalid and empty
+    bool match(const art::Event& evt, const common::MCParticleGraph& graph, Pattern& pattern, std::vector<bool>& found) const
+    {
+        pattern.assign(_tools.size(), Signature());
+        found.assign(_tools.size(), false);
+        if (_tools.empty())
+            return true;
+
+        auto const& truth_handle = evt.getValidHandle<std::vector<simb::MCTruth>>(_MCTproducer);
+        if (truth_handle->size() != 1)
+            return false;
+
+        size_t n_remaining = _tools.size();
+        for (size_t i = 0; i < graph.size() && n_remaining > 0; ++i)
+        {
+            if (graph.process(i) != common::Process::kPrimary)
+                continue;
+
+            const auto it = _tools_by_pdg.find(std::abs(graph.particle(i)->PdgCode()));
+            if (it == _tools_by_pdg.end())
+                continue;
+
+            for (const size_t t : it->second)
+            {
+                if (found[t] || !_tools[t]->matchPattern(graph, i, pattern[t]))
+                    continue;
+
+                found[t] = true;
+                --n_remaining;
+            }
+        }
+
+        for (size_t t = 0; t < _tools.size(); ++t)
+        {
+            if (!found[t])
+                pattern[t] = Signature(SignatureInvalid, {});
+        }
+
+        return n_remaining == 0;
+    }
+
+private:
+    art::InputTag _MCTproducer;
+    std::vector<const SignatureToolBase*> _tools;
+    std::unordered_map<int, std::vector<size_t>> _tools_by_pdg;
+};
+
+}
+
+#endif
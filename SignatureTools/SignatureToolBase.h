@@ -10,8 +10,8 @@
 #include "CommonFunctions/Types.h"
 #include "TTree.h"
 #include <limits>
-#include "TDatabasePDG.h"
-#include "TParticlePDG.h"
+#include <algorithm>
+#include <array>
 
 #include "nusimdata/SimulationBase/MCParticle.h"
 #include "nusimdata/SimulationBase/MCParticle.h"
@@ -19,6 +19,8 @@
 
 #include "CommonFunctions/Pandora.h"
 #include "CommonFunctions/Scatters.h"
+#include "CommonFunctions/MCParticleGraph.h"
+#include "CommonFunctions/ParticleTable.h"
 #include "CommonFunctions/Corrections.h"
 #include "CommonFunctions/Containment.h"
 
@@ -57,6 +59,28 @@ std::string GetSignatureName(const Signature& sig)
 
 }
 
+// Declarative description of the truth topology of a signature, starting from a primary particle
+// (the root). A pattern without decay modes matches the root alone. Otherwise the root, or the
+// single via daughter it decays through, must decay into one of the listed modes, every product
+// must pass the momentum thresholds, and the charged products and their same-species rescatters
+// make up the signature
+struct DecayPattern
+{
+    SignatureType type = SignatureInvalid;
+    std::vector<int> root_pdgs;                                 // |PDG| of the root
+    bool root_decays = false;                                   // root must end in Decay
+    int root_daughters = -1;                                    // required NumberDaughters of the root, -1 for any
+    bool fill_root = false;                                     // root must pass the thresholds and joins the signature
+    bool root_rescatters = false;                               // same-species rescatters of the root join it
+    std::vector<common::Process> root_end_processes;            // accepted EndProcess of the root's last rescatter, empty for any
+    int via_pdg = 0;                                            // PDG of the only daughter the root decays through, 0 for none
+    int via_daughters = -1;                                     // required NumberDaughters of the via particle, -1 for any
+    std::vector<common::Process> product_processes;             // processes that may have created the products, empty for any
+    bool skip_em_and_nuclei = false;                            // electrons, photons and nuclei are not products
+    std::vector<std::pair<int, std::vector<int>>> modes;        // PDG of the root (0 for any) and of its decay products
+    bool assess_rescatters = true;                              // product rescatters must pass the thresholds to join
+};
+
 class SignatureToolBase 
 {
 public:
@@ -67,9 +91,35 @@ public:
     {
         _MCPproducer = pset.get<art::InputTag>("MCPproducer", "largeant");
         _MCTproducer = pset.get<art::InputTag>("MCTproducer", "generator");
+
+        for (size_t i = 0; i < common::kParticleTable.size(); ++i)
+            _thresholds[i] = common::kParticleTable[i].threshold;
+
+        const std::array<std::pair<const char*, int>, 9> threshold_params = {{
+            {"MuonThreshold", 13},
+            {"ElectronThreshold", 11},
+            {"PionThreshold", 211},
+            {"ProtonThreshold", 2212},
+            {"KaonThreshold", 321},
+            {"SigmaPlusThreshold", 3222},
+            {"SigmaMinusThreshold", 3112},
+            {"XiMinusThreshold", 3312},
+            {"OmegaMinusThreshold", 3334}
+        }};
+        for (const auto& [name, pdg] : threshold_params)
+        {
+            const int index = common::ParticleIndex(pdg);
+            _thresholds[index] = pset.get<float>(name, _thresholds[index]);
+        }
     }
 
     bool constructSignature(art::Event const& evt, Signature& signature)
+    {
+        return this->constructSignature(evt, signature, this->particleGraph(evt));
+    }
+
+    // As above, with the particle graph of the event built once by the caller and shared by every tool
+    bool constructSignature(art::Event const& evt, Signature& signature, const common::MCParticleGraph& graph)
     {
         signature.second.clear();
         auto const& truth_handle = evt.getValidHandle<std::vector<simb::MCTruth>>(_MCTproducer);
@@ -77,7 +127,7 @@ public:
             return false;
 
         bool signature_found = false;
-        this->findSignature(evt, signature, signature_found);
+        this->findSignature(evt, graph, signature, signature_found);
 
         if (!signature_found){
           //signature.clear();
@@ -88,37 +138,124 @@ public:
         return signature_found;
     }
 
+    const DecayPattern& decayPattern() const { return _pattern; }
+
+    // Evaluates the pattern with the particle at root as its root, filling the signature on a match
+    bool matchPattern(const common::MCParticleGraph& graph, const int root, Signature& signature) const
+    {
+        const simb::MCParticle& mcp = *graph.particle(root);
+        if (_pattern.root_decays && graph.endProcess(root) != common::Process::kDecay)
+            return false;
+
+        if (_pattern.root_daughters >= 0 && mcp.NumberDaughters() != _pattern.root_daughters)
+            return false;
+
+        std::vector<art::Ptr<simb::MCParticle>> particles;
+        int root_end = root;
+        if (_pattern.fill_root)
+        {
+            if (!this->assessParticle(mcp))
+                return false;
+
+            particles.push_back(graph.particle(root));
+            if (_pattern.root_rescatters)
+                root_end = this->addRescatters(graph, root, true, particles);
+        }
+
+        if (!_pattern.modes.empty())
+        {
+            if (!_pattern.root_end_processes.empty())
+            {
+                const common::Process end_process = graph.endProcess(root_end);
+                if (std::find(_pattern.root_end_processes.begin(), _pattern.root_end_processes.end(), end_process) == _pattern.root_end_processes.end())
+                    return false;
+            }
+
+            int parent = root;
+            if (_pattern.via_pdg != 0)
+            {
+                const auto via = graph.daughters(root);
+                if (via.size() != 1)
+                    return false;
+
+                parent = via[0];
+                if (graph.particle(parent)->PdgCode() != _pattern.via_pdg || graph.process(parent) != common::Process::kDecay || graph.endProcess(parent) != common::Process::kDecay)
+                    return false;
+
+                if (_pattern.via_daughters >= 0 && graph.particle(parent)->NumberDaughters() != _pattern.via_daughters)
+                    return false;
+            }
+
+            const auto& product_processes = _pattern.product_processes;
+            std::vector<int> products;
+            std::vector<int> product_pdgs;
+            for (const int daughter : graph.daughters(parent))
+            {
+                const int pdg = graph.particle(daughter)->PdgCode();
+                if (!product_processes.empty() && std::find(product_processes.begin(), product_processes.end(), graph.process(daughter)) == product_processes.end())
+                    continue;
+
+                if (_pattern.skip_em_and_nuclei && (std::abs(pdg) == 11 || std::abs(pdg) == 22 || std::abs(pdg) >= 1000000000))
+                    continue;
+
+                products.push_back(daughter);
+                product_pdgs.push_back(pdg);
+            }
+
+            std::sort(product_pdgs.begin(), product_pdgs.end());
+            const bool valid_decay = std::any_of(_pattern.modes.begin(), _pattern.modes.end(), [&](const auto& mode) {
+                if (mode.first != 0 && mode.first != mcp.PdgCode())
+                    return false;
+
+                std::vector<int> sorted_mode = mode.second;
+                std::sort(sorted_mode.begin(), sorted_mode.end());
+                return sorted_mode == product_pdgs;
+            });
+
+            if (!valid_decay)
+                return false;
+
+            for (const int product : products)
+            {
+                if (!this->assessParticle(*graph.particle(product)))
+                    return false;
+            }
+
+            for (const int product : products)
+            {
+                if (common::ParticleCharge(graph.particle(product)->PdgCode()) == 0)
+                    continue;
+
+                particles.push_back(graph.particle(product));
+                this->addRescatters(graph, product, _pattern.assess_rescatters, particles);
+            }
+        }
+
+        signature.first = _pattern.type;
+        signature.second = std::move(particles);
+        return true;
+    }
+
 protected:
     art::InputTag _MCPproducer, _MCTproducer;
+    DecayPattern _pattern;
 
+    // Charged particles must start inside the fiducial volume above the momentum threshold of their
+    // species, and species without a threshold never pass. Neutral particles always pass
     bool assessParticle(const simb::MCParticle& mcp) const 
     {
-        float mom_mag = mcp.Momentum().Vect().Mag();
-        int abs_pdg = std::abs(mcp.PdgCode());
-
-        const TParticlePDG* particle = TDatabasePDG::Instance()->GetParticle(mcp.PdgCode());
-        if (particle->Charge() == 0.0) 
+        if (common::ParticleCharge(mcp.PdgCode()) == 0) 
             return true;
 
-        std::unordered_map<int, float> thresh_map = {
-            {211, 0.1},    // pi
-            {13, 0.1},     // mu
-            {2212, 0.3},   // p
-            {321, 0.2},    // K
-            {11, 0.1},     // e
-            {3222, 0.1},   // sigma+
-            {3112, 0.1},   // sigma-
-        };
-       
         // Check start is inside the TPC
         double pos[3] = {(double)mcp.Vx(),(double)mcp.Vy(),(double)mcp.Vz()};
         if(!common::point_inside_fv(pos)) return false;
 
-        auto it = thresh_map.find(abs_pdg);
-        if (it != thresh_map.end())
-            return mom_mag > it->second;
+        const int index = common::ParticleIndex(mcp.PdgCode());
+        if (index == common::kNoParticle || _thresholds[index] < 0.f)
+            return false;
 
-        return false;
+        return mcp.Momentum().Vect().Mag() > _thresholds[index];
     }
 
     void fillSignature(const art::Ptr<simb::MCParticle>& mcp, Signature& signature) 
@@ -126,7 +263,50 @@ protected:
         signature.second.push_back(mcp);
     }
 
-    virtual void findSignature(art::Event const& evt, Signature& signature, bool& signature_found) = 0;
+    // Particle graph of the event, built here only when the caller did not supply one
+    const common::MCParticleGraph& particleGraph(art::Event const& evt) const
+    {
+        if (!_local_graph.isFor(evt))
+            _local_graph.build(evt, _MCPproducer);
+
+        return _local_graph;
+    }
+
+    // Scans the primaries for the first one matching the pattern
+    virtual void findSignature(art::Event const& evt, const common::MCParticleGraph& graph, Signature& signature, bool& signature_found)
+    {
+        signature.first = _pattern.type;
+
+        for (size_t i = 0; i < graph.size() && !signature_found; ++i)
+        {
+            if (graph.process(i) != common::Process::kPrimary)
+                continue;
+
+            const int abs_pdg = std::abs(graph.particle(i)->PdgCode());
+            if (std::find(_pattern.root_pdgs.begin(), _pattern.root_pdgs.end(), abs_pdg) != _pattern.root_pdgs.end())
+                signature_found = this->matchPattern(graph, i, signature);
+        }
+    }
+
+private:
+    // Adds the same-species daughters of the particle, and theirs in turn, returning the last one reached
+    int addRescatters(const common::MCParticleGraph& graph, const int particle, const bool assess, std::vector<art::Ptr<simb::MCParticle>>& particles) const
+    {
+        int end_particle = particle;
+        for (const int daughter : graph.daughters(particle))
+        {
+            if (graph.particle(daughter)->PdgCode() != graph.particle(particle)->PdgCode() || (assess && !this->assessParticle(*graph.particle(daughter))))
+                continue;
+
+            particles.push_back(graph.particle(daughter));
+            end_particle = this->addRescatters(graph, daughter, assess, particles);
+        }
+
+        return end_particle;
+    }
+
+    std::array<float, common::kParticleTable.size()> _thresholds{};
+    mutable common::MCParticleGraph _local_graph;
 };
 
 } 
@@ -3,6 +3,7 @@
 
 #include "TVector3.h"
 #include "art/Framework/Principal/Event.h"
+#include "CommonFunctions/MCParticleGraph.h"
 
 namespace signature
 {
@@ -12,6 +13,7 @@ class VertexToolBase
 public:
     virtual ~VertexToolBase() = default;
     virtual TVector3 findVertex(const art::Event& evt) const = 0;
+    virtual TVector3 findVertex(const art::Event& evt, const common::MCParticleGraph& graph) const = 0;
 };
 
 }
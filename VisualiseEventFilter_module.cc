@@ -20,6 +20,7 @@
 #include "CommonFunctions/Pandora.h"
 #include "CommonFunctions/Scatters.h"
 #include "CommonFunctions/Visualisation.h"
+#include "CommonFunctions/MCParticleGraph.h"
 
 #include "lardataobj/AnalysisBase/BackTrackerMatchingData.h"
 #include "lardataobj/AnalysisBase/Calorimetry.h"
@@ -36,6 +37,7 @@
 
 #include "SignatureTools/SignatureToolBase.h"
 #include "SignatureTools/VertexToolBase.h"
+#include "SignatureTools/SignatureMatcher.h"
 
 #include <vector>
 #include <map>
@@ -56,12 +58,14 @@ public:
     bool filter(art::Event &e) override;
 
 private:
-    art::InputTag _HitProducer, _MCPproducer, _MCTproducer, _BacktrackTag;
+    art::InputTag _HitProducer, _MCPproducer, _MCTproducer, _BacktrackTag, _HitTruthOwnerTag;
 
     std::string _mode;
     std::vector<std::tuple<int, int, int>> _target_events;
 
     std::vector<std::unique_ptr<::signature::SignatureToolBase>> _signatureToolsVec;
+    ::signature::SignatureMatcher _signature_matcher;
+    common::MCParticleGraph _particle_graph;
 };
 
 VisualiseEventFilter::VisualiseEventFilter(fhicl::ParameterSet const &pset)
@@ -70,7 +74,9 @@ VisualiseEventFilter::VisualiseEventFilter(fhicl::ParameterSet const &pset)
     , _MCPproducer{pset.get<art::InputTag>("MCPproducer", "largeant")}
     , _MCTproducer{pset.get<art::InputTag>("MCTproducer", "generator")}
     , _BacktrackTag{pset.get<art::InputTag>("BacktrackTag", "gaushitTruthMatch")}
+    , _HitTruthOwnerTag{pset.get<art::InputTag>("HitTruthOwnerTag", "")}
     , _mode{pset.get<std::string>("Mode", "nominal")}
+    , _signature_matcher{_MCTproducer}
 {
     if (pset.has_key("TargetEvents")) {
         for (auto const &entry : pset.get<std::vector<std::vector<int>>>("TargetEvents")) {
@@ -90,6 +96,7 @@ VisualiseEventFilter::VisualiseEventFilter(fhicl::ParameterSet const &pset)
     {
         auto const tool_pset = tool_psets.get<fhicl::ParameterSet>(tool_pset_label);
         _signatureToolsVec.push_back(art::make_tool<::signature::SignatureToolBase>(tool_pset));
+        _signature_matcher.add(_signatureToolsVec.back().get());
     };
 }
 
@@ -106,17 +113,16 @@ bool VisualiseEventFilter::filter(art::Event &e)
             return false;
     }
 
-    signature::Pattern pattern;
-    for (auto& signatureTool : _signatureToolsVec) {
-        signature::Signature signature;
-        if (!signatureTool->constructSignature(e, signature))
-            return false;
+    if (!_signatureToolsVec.empty())
+        _particle_graph.build(e, _MCPproducer);
 
-        pattern.push_back(signature);
-    }
+    signature::Pattern pattern;
+    std::vector<bool> sig_found;
+    if (!_signature_matcher.match(e, _particle_graph, pattern, sig_found))
+        return false;
 
     std::string filename = "event_" + std::to_string(e.run()) + "_" + std::to_string(e.subRun()) + "_" + std::to_string(e.event());
-    common::visualiseSignature(e, _MCPproducer, _HitProducer, _BacktrackTag, pattern, filename);
+    common::visualiseSignature(e, _MCPproducer, _HitProducer, _BacktrackTag, _HitTruthOwnerTag, pattern, filename);
 
     return true;
 }
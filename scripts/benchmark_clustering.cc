@@ -0,0 +1,291 @@
+// Compares the proximity clustering engine of common::cluster with the map-based implementation it
+// replaced, on generated events of dense electromagnetic showers in all three planes.
+// Usage: benchmark_clustering [n_events] [n_showers] [cell_size] [radius]
+// Clusters are compared as sets of hits, as the two engines order them differently. The map-based
+// engine also gave a hit a cluster of its own when it had been merged into a cluster from a
+// neighbouring cell but found no compatible hit itself, so that the hit was listed twice. The
+// comparison is made against the map-based engine with that hit kept in the cluster it joined,
+// and the number of hits it listed twice is reported.
+
+#include "CommonFunctions/ProximityClusterer.h"
+
+#include <iostream>
+#include <map>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <string>
+#include <cmath>
+
+namespace
+{
+    struct SimHit
+    {
+        int plane;
+        float peak;
+        float rms;
+        unsigned int channel;
+        unsigned int wire;
+    };
+
+    constexpr unsigned int kWiresPerPlane[3] = {2400, 2400, 3456};
+
+    // Showers as branching random walks from a common vertex, one hit per wire crossing
+    std::vector<SimHit> MakeEvent(std::mt19937& rng, const int n_showers)
+    {
+        std::vector<SimHit> hits;
+        std::uniform_real_distribution<float> unit(0.f, 1.f);
+        std::normal_distribution<float> gauss(0.f, 1.f);
+
+        for (int plane = 0; plane < 3; ++plane)
+        {
+            const float vtx_wire = 200.f + unit(rng) * (kWiresPerPlane[plane] - 400.f);
+            const float vtx_tick = 1500.f + unit(rng) * 3000.f;
+            const unsigned int channel_offset = plane * 2400;
+
+            for (int s = 0; s < n_showers; ++s)
+            {
+                struct Walker { float wire, tick, slope; int steps; };
+                std::vector<Walker> walkers = {{vtx_wire, vtx_tick, 40.f * gauss(rng), 100 + static_cast<int>(unit(rng) * 200)}};
+                while (!walkers.empty())
+                {
+                    Walker w = walkers.back();
+                    walkers.pop_back();
+                    const float direction = unit(rng) < 0.5f ? -1.f : 1.f;
+                    for (int step = 0; step < w.steps; ++step)
+                    {
+                        w.wire += direction;
+                        w.tick += w.slope + 2.f * gauss(rng);
+                        w.slope += 1.5f * gauss(rng);
+                        if (w.wire < 0.f || w.wire >= kWiresPerPlane[plane])
+                            break;
+
+                        const unsigned int wire = static_cast<unsigned int>(w.wire);
+                        const int n_deposits = 1 + static_cast<int>(unit(rng) * 1.5f);
+                        for (int d = 0; d < n_deposits; ++d)
+                            hits.push_back({plane, w.tick + 8.f * gauss(rng), 2.f + 4.f * unit(rng), channel_offset + wire, wire});
+
+                        if (unit(rng) < 0.02f && walkers.size() < 32)
+                            walkers.push_back({w.wire, w.tick, w.slope + 30.f * gauss(rng), static_cast<int>((w.steps - step) * unit(rng))});
+                    }
+                }
+            }
+
+            for (int n = 0; n < 300; ++n)
+            {
+                const unsigned int wire = static_cast<unsigned int>(unit(rng) * kWiresPerPlane[plane]);
+                hits.push_back({plane, 6400.f * unit(rng), 2.f + 4.f * unit(rng), channel_offset + wire, wire});
+            }
+        }
+
+        std::shuffle(hits.begin(), hits.end(), rng);
+        return hits;
+    }
+
+    // The map-based engine as it was, over plain hits rather than art::Ptr
+    bool ReferenceTimeOverlap(const SimHit& h1, const SimHit& h2, const float& _time2cm, double& dmin)
+    {
+        auto T1 = h1.peak * _time2cm;
+        auto T2 = h2.peak * _time2cm;
+        auto W1 = h1.rms * _time2cm;
+        auto W2 = h2.rms * _time2cm;
+
+        double d = dmin;
+        if (T1 > T2) {
+            if ((T2 + W2) > (T1 - W1)) return true;
+            d = (T1 - W1) - (T2 + W2);
+            if (d < dmin) dmin = d;
+        }
+        else {
+            if ((T1 + W1) > (T2 - W2)) return true;
+            d = (T2 - W2) - (T1 + W1);
+            if (d < dmin) dmin = d;
+        }
+
+        return false;
+    }
+
+    bool ReferenceHitsCompatible(const SimHit& h1, const SimHit& h2, const float& _time2cm, const float& _wire2cm, const float& _radius)
+    {
+        if (h1.plane != h2.plane)
+            return false;
+
+        double dt = (h1.peak - h2.peak) * _time2cm;
+        if (ReferenceTimeOverlap(h1, h2, _time2cm, dt) == true)
+            dt = 0;
+
+        double dw = fabs(((double)h1.channel - (double)h2.channel) * _wire2cm);
+        if (dw > 0.3) dw -= 0.3;
+
+        double d = dt * dt + dw * dw;
+        return !(d > (_radius * _radius));
+    }
+
+    void ReferenceCluster(const std::vector<SimHit>& hits, const int pl, const float& _time2cm, const float& _wire2cm,
+                          const float& _cellSize, const float& _radius, const bool repeat_merged_hits, std::vector<std::vector<unsigned int>>& out)
+    {
+        std::map<std::pair<int, int>, std::vector<size_t>> _hitMap;
+        for (size_t h = 0; h < hits.size(); h++)
+        {
+            if (hits[h].plane != pl)
+                continue;
+
+            double t = hits[h].peak * _time2cm;
+            double w = hits[h].wire * _wire2cm;
+            _hitMap[std::make_pair(int(w / _cellSize), int(t / _cellSize))].push_back(h);
+        }
+
+        std::map<size_t, size_t> _clusterMap;
+        std::map<size_t, std::vector<size_t>> _clusters;
+        size_t maxClusterID = 0;
+
+        for (auto it = _hitMap.begin(); it != _hitMap.end(); it++)
+        {
+            const int i = it->first.first, j = it->first.second;
+            const std::vector<size_t> cellhits = it->second;
+
+            std::vector<size_t> neighborhits;
+            const std::pair<int, int> cells[9] = {{i, j}, {i - 1, j}, {i, j - 1}, {i - 1, j - 1}, {i, j + 1},
+                                                  {i + 1, j}, {i + 1, j + 1}, {i - 1, j + 1}, {i + 1, j - 1}};
+            for (const auto& cell : cells)
+            {
+                auto found = _hitMap.find(cell);
+                if (found != _hitMap.end())
+                    neighborhits.insert(neighborhits.end(), found->second.begin(), found->second.end());
+            }
+
+            for (const size_t hit1 : cellhits)
+            {
+                bool matched = false;
+                for (const size_t hit2 : neighborhits)
+                {
+                    if (hit1 == hit2) continue;
+                    if (!ReferenceHitsCompatible(hits[hit1], hits[hit2], _time2cm, _wire2cm, _radius))
+                        continue;
+
+                    matched = true;
+                    const bool has1 = _clusterMap.find(hit1) != _clusterMap.end();
+                    const bool has2 = _clusterMap.find(hit2) != _clusterMap.end();
+                    if (has1 && has2) {
+                        if (_clusterMap[hit1] != _clusterMap[hit2]) {
+                            auto idx1 = _clusterMap[hit1];
+                            auto idx2 = _clusterMap[hit2];
+                            auto hits1 = _clusters[idx1];
+                            for (auto h : _clusters[idx2]) {
+                                hits1.push_back(h);
+                                _clusterMap[h] = idx1;
+                            }
+                            _clusters[idx1] = hits1;
+                            _clusters.erase(idx2);
+                        }
+                    }
+                    else if (has2) {
+                        _clusterMap[hit1] = _clusterMap[hit2];
+                        _clusters[_clusterMap[hit2]].push_back(hit1);
+                    }
+                    else if (has1) {
+                        _clusterMap[hit2] = _clusterMap[hit1];
+                        _clusters[_clusterMap[hit1]].push_back(hit2);
+                    }
+                    else {
+                        _clusterMap[hit1] = maxClusterID;
+                        _clusterMap[hit2] = maxClusterID;
+                        _clusters[maxClusterID] = {hit1, hit2};
+                        maxClusterID += 1;
+                    }
+                }
+
+                if (matched == false && (repeat_merged_hits || _clusterMap.find(hit1) == _clusterMap.end())) {
+                    _clusterMap[hit1] = maxClusterID;
+                    _clusters[maxClusterID] = {hit1};
+                    maxClusterID += 1;
+                }
+            }
+        }
+
+        for (auto& entry : _clusters)
+            out.emplace_back(entry.second.begin(), entry.second.end());
+    }
+
+    std::vector<std::vector<unsigned int>> Canonical(std::vector<std::vector<unsigned int>> clusters)
+    {
+        for (auto& clus : clusters)
+            std::sort(clus.begin(), clus.end());
+        std::sort(clusters.begin(), clusters.end());
+
+        return clusters;
+    }
+
+    size_t CountRepeatedHits(const std::vector<std::vector<unsigned int>>& clusters)
+    {
+        std::vector<unsigned int> all;
+        for (const auto& clus : clusters)
+            all.insert(all.end(), clus.begin(), clus.end());
+        std::sort(all.begin(), all.end());
+
+        return all.size() - (std::unique(all.begin(), all.end()) - all.begin());
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int n_events = argc > 1 ? std::stoi(argv[1]) : 20;
+    const int n_showers = argc > 2 ? std::stoi(argv[2]) : 4;
+    const float cell_size = argc > 3 ? std::stof(argv[3]) : 1.f;
+    const float radius = argc > 4 ? std::stof(argv[4]) : 0.6f;
+
+    const float time2cm = 0.5f * 0.1098f;
+    const float wire2cm = 0.3f;
+
+    std::mt19937 rng(12345);
+    common::ProximityClusterer clusterer;
+
+    double reference_time = 0., engine_time = 0.;
+    size_t n_hits = 0, n_identical = 0, n_repeated_hits = 0;
+    for (int e = 0; e < n_events; ++e)
+    {
+        const std::vector<SimHit> hits = MakeEvent(rng, n_showers);
+        n_hits += hits.size();
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::vector<unsigned int>> reference;
+        for (int plane = 0; plane < 3; ++plane)
+            ReferenceCluster(hits, plane, time2cm, wire2cm, cell_size, radius, true, reference);
+        reference_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        common::ProximityHits proximity_hits;
+        proximity_hits.time2cm = time2cm;
+        proximity_hits.wire2cm = wire2cm;
+        std::vector<std::vector<uint32_t>> plane_hits(3);
+        for (size_t h = 0; h < hits.size(); ++h)
+        {
+            proximity_hits.add(hits[h].plane, hits[h].peak, hits[h].rms, hits[h].channel, hits[h].wire, cell_size);
+            plane_hits[hits[h].plane].push_back(h);
+        }
+
+        std::vector<std::vector<unsigned int>> clusters;
+        for (int plane = 0; plane < 3; ++plane)
+            clusterer.cluster(proximity_hits, plane_hits[plane], radius, clusters);
+        engine_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        n_repeated_hits += CountRepeatedHits(reference);
+
+        std::vector<std::vector<unsigned int>> expected;
+        for (int plane = 0; plane < 3; ++plane)
+            ReferenceCluster(hits, plane, time2cm, wire2cm, cell_size, radius, false, expected);
+
+        if (CountRepeatedHits(expected) == 0 && Canonical(expected) == Canonical(clusters))
+            ++n_identical;
+    }
+
+    std::cout << "Events: " << n_events << ", mean hits per event: " << n_hits / std::max(1, n_events) << std::endl;
+    std::cout << "Map-based engine: " << 1e3 * reference_time / n_events << " ms/event" << std::endl;
+    std::cout << "Grid engine: " << 1e3 * engine_time / n_events << " ms/event, single thread" << std::endl;
+    std::cout << "Speedup: " << reference_time / std::max(engine_time, 1e-12) << "x" << std::endl;
+    std::cout << "Identical clusters: " << n_identical << "/" << n_events << " events" << std::endl;
+    std::cout << "Hits listed twice by the map-based engine: " << n_repeated_hits << std::endl;
+
+    return n_identical == static_cast<size_t>(n_events) ? 0 : 1;
+}
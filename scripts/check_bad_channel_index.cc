@@ -0,0 +1,128 @@
+// Checks the queries of common::BadChannelIndex against direct scans of the mask, on random masks
+// with isolated dead channels and dead runs of up to a few hundred channels, and on the edge cases
+// of an empty mask and masks with every channel live or dead.
+// Usage: check_bad_channel_index [n_masks] [n_queries]
+// Ranges are drawn to reach past both ends of the mask and with lo > hi, as callers pass them.
+
+#include "CommonFunctions/BadChannelIndex.h"
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <string>
+#include <cstdlib>
+
+namespace
+{
+    std::vector<bool> MakeMask(std::mt19937& rng, const size_t n)
+    {
+        std::vector<bool> mask(n, false);
+        std::uniform_real_distribution<float> unit(0.f, 1.f);
+
+        const float isolated = 0.05f * unit(rng);
+        for (size_t ch = 0; ch < n; ++ch)
+            mask[ch] = unit(rng) < isolated;
+
+        const int n_runs = static_cast<int>(unit(rng) * 10);
+        for (int r = 0; r < n_runs && n > 0; ++r)
+        {
+            const size_t start = rng() % n;
+            const size_t length = 1 + rng() % 300;
+            for (size_t ch = start; ch < std::min(n, start + length); ++ch)
+                mask[ch] = true;
+        }
+
+        return mask;
+    }
+
+    bool Bad(const std::vector<bool>& mask, const int ch)
+    {
+        return ch >= 0 && static_cast<size_t>(ch) < mask.size() && mask[ch];
+    }
+
+    int ScanBad(const std::vector<bool>& mask, int lo, int hi)
+    {
+        if (lo > hi)
+            std::swap(lo, hi);
+
+        int n = 0;
+        for (int ch = lo; ch <= hi; ++ch)
+            n += Bad(mask, ch);
+
+        return n;
+    }
+
+    int ScanLongestRun(const std::vector<bool>& mask, int lo, int hi)
+    {
+        if (lo > hi)
+            std::swap(lo, hi);
+
+        int longest = 0, run = 0;
+        for (int ch = lo; ch <= hi; ++ch)
+        {
+            run = Bad(mask, ch) ? run + 1 : 0;
+            longest = std::max(longest, run);
+        }
+
+        return longest;
+    }
+
+    int ScanDistance(const std::vector<bool>& mask, const int ch)
+    {
+        if (ch < 0 || static_cast<size_t>(ch) >= mask.size())
+            return common::BadChannelIndex::kNoBadChannel;
+
+        int distance = common::BadChannelIndex::kNoBadChannel;
+        for (size_t other = 0; other < mask.size(); ++other)
+        {
+            if (mask[other])
+                distance = std::min(distance, std::abs(static_cast<int>(other) - ch));
+        }
+
+        return distance;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int n_masks = argc > 1 ? std::stoi(argv[1]) : 200;
+    const int n_queries = argc > 2 ? std::stoi(argv[2]) : 2000;
+
+    std::mt19937 rng(2024);
+
+    std::vector<std::vector<bool>> masks = {{}, std::vector<bool>(1, true), std::vector<bool>(1000, false), std::vector<bool>(1000, true)};
+    for (int m = 0; m < n_masks; ++m)
+        masks.push_back(MakeMask(rng, 1 + rng() % 9000));
+
+    common::BadChannelIndex index;
+    size_t n_failures = 0;
+    for (const auto& mask : masks)
+    {
+        index.build(mask);
+
+        const int n = mask.size();
+        for (int q = 0; q < n_queries; ++q)
+        {
+            const int lo = static_cast<int>(rng() % (n + 20)) - 10;
+            const int hi = rng() % 4 == 0 ? lo + static_cast<int>(rng() % 16) - 8 : static_cast<int>(rng() % (n + 20)) - 10;
+            const int act_reg = rng() % 8;
+
+            const bool ok = index.isBad(lo) == Bad(mask, lo) &&
+                            index.nBad(lo, hi) == ScanBad(mask, lo, hi) &&
+                            index.longestRun(lo, hi) == ScanLongestRun(mask, lo, hi) &&
+                            index.distanceToBad(lo) == ScanDistance(mask, lo) &&
+                            index.isRegionActive(lo, act_reg) == (ScanDistance(mask, lo) > act_reg);
+            if (!ok)
+            {
+                if (n_failures < 10)
+                    std::cout << "Mismatch on a mask of " << n << " channels for [" << lo << ", " << hi << "]" << std::endl;
+                ++n_failures;
+            }
+        }
+    }
+
+    std::cout << "Masks: " << masks.size() << ", queries per mask: " << n_queries << ", mismatches: " << n_failures << std::endl;
+
+    return n_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,24 @@
+#!/bin/bash
+
+# Index the training shards from grid jobs without copying them
+# Usage: index_shards.sh /path/to/training/data/folder/ 
+# Execute in directory below the where all of your shards and manifests are
+# Training data folder needs to be somewhere on /exp/uboone/data/
+
+destination=${1}
+
+if [[ -z "$destination" ]]; then
+    echo "Usage: index_shards.sh /path/to/training/data/folder/"
+    exit 1
+fi
+
+mkdir -p ${destination}
+
+manifest_list="$(find ~+ -type f -name '*.manifest')"
+
+if [[ -z "$manifest_list" ]]; then
+    echo "No manifests found."
+    exit 1
+fi
+
+index_training_shards ${destination} ${manifest_list}
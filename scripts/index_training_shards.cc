@@ -0,0 +1,85 @@
+// Builds one global index per view over the training shards listed in job manifests.
+// Usage: index_training_shards /path/to/output/folder/ job1.manifest [job2.manifest ...]
+// The shards are read in place, so pass absolute manifest paths if the index is to be
+// used from another directory.
+
+#include "CommonFunctions/TrainingSampleIO.h"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <array>
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <output_dir> <manifest> [<manifest> ...]" << std::endl;
+        return 1;
+    }
+
+    std::string destination = argv[1];
+    if (!destination.empty() && destination.back() != '/')
+        destination += '/';
+
+    const std::array<std::string, 3> view_names = {"U", "V", "W"};
+    std::array<common::TrainingSampleIndex, 3> indices;
+    std::array<uint64_t, 3> n_bytes = {0, 0, 0};
+    size_t n_jobs = 0, n_skipped = 0;
+
+    for (int a = 2; a < argc; ++a)
+    {
+        const std::string manifest = argv[a];
+        try {
+            std::string job;
+            std::vector<common::TrainingShardInfo> shards;
+            common::ReadTrainingManifest(manifest, job, shards);
+
+            // Check every shard of the job before indexing any of them, so a job is taken whole or not at all
+            for (const auto& shard : shards)
+            {
+                if (shard.view >= indices.size())
+                    throw std::runtime_error("shard " + shard.file + " has unknown view");
+
+                std::ifstream in(shard.file, std::ios::binary | std::ios::ate);
+                if (!in.is_open() || static_cast<uint64_t>(in.tellg()) != shard.file_size)
+                    throw std::runtime_error("shard " + shard.file + " is missing or its size does not match the manifest");
+
+                common::TrainingSampleReader reader(shard.file);
+                if (reader.size() != shard.n_records || reader.dataEnd() != shard.data_end)
+                    throw std::runtime_error("shard " + shard.file + " index does not match the manifest");
+            }
+
+            for (const auto& shard : shards)
+            {
+                indices[shard.view].addShard(shard.file);
+                n_bytes[shard.view] += shard.data_end - shard.data_begin;
+            }
+
+            ++n_jobs;
+            std::cout << "Indexed job " << job << " (" << manifest << ")" << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "Skipping " << manifest << ": " << e.what() << std::endl;
+            ++n_skipped;
+        }
+    }
+
+    for (size_t v = 0; v < indices.size(); ++v)
+    {
+        const std::string output = destination + "training_index_" + view_names[v] + ".bin";
+        try {
+            indices[v].write(output);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+
+        std::cout << "Plane " << view_names[v] << ": " << indices[v].size() << " events in " << indices[v].nShards()
+                  << " shards, " << n_bytes[v] << " bytes, index " << output << std::endl;
+    }
+
+    std::cout << n_jobs << " jobs indexed, " << n_skipped << " skipped" << std::endl;
+
+    return n_skipped > 0 ? 2 : 0;
+}
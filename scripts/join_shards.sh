@@ -0,0 +1,29 @@
+#!/bin/bash
+
+destination=${1}
+
+if [[ -z "$destination" ]]; then
+    echo "Error: No destination folder provided."
+    echo "Usage: join_shards.sh /path/to/training/data/folder/"
+    exit 1
+fi
+
+shard_dir="$(realpath -m "${destination}")/shards"
+mkdir -p "$shard_dir"
+
+echo "Extracting shards from log.tar files..."
+find log -type f -name "log.tar" | while read tarfile; do
+    echo "Processing $tarfile"
+    tar -xf "$tarfile" -C "$shard_dir" --wildcards '*.bin' '*.manifest' || echo "Failed to extract shards from $tarfile"
+done
+
+manifest_list=$(find "$shard_dir" -type f -name "*.manifest")
+
+if [[ -z "$manifest_list" ]]; then
+    echo "No manifests found. Nothing to index."
+    exit 1
+fi
+
+index_training_shards "${destination}" $manifest_list
+
+echo "Indexing completed. Indices are in $destination, shards in $shard_dir."
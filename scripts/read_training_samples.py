@@ -0,0 +1,221 @@
+#!/usr/bin/env python3
+"""Reads the binary training samples written by ConvolutionNetworkAlgo.
+
+Layout, matching CommonFunctions/TrainingSampleIO.h (version 1, all values little-endian):
+
+  shard (one per job and view, <output>_<job>_<U|V|W>.bin)
+    file header  char[8] "SFSTRAIN", uint32 version, uint32 compression (0 none, 1 zstd),
+                 uint32 view, uint32 reserved
+    blocks       uint32 raw size, uint32 stored size, stored bytes (raw records or one zstd frame)
+    index        uint64 n records, then per record uint64 block offset, uint32 offset in block,
+                 uint32 record size
+    footer       uint64 index offset, char[8] "SFSINDEX"
+
+  record
+    header       uint32 n_hits, n_flags, run, subrun, event, height, width,
+                 float32 x_vtx, z_vtx, drift_min, drift_max, wire_min, wire_max
+    hits         n_hits x (float32 x, float32 z, float32 q, uint32 flags)
+
+  global index (written by index_training_shards, one per view)
+    char[8] "SFSGINDX", uint32 version, uint32 view, uint32 n shards,
+    per shard uint32 length and the path, uint64 n records,
+    per record uint32 shard, uint32 offset in block, uint64 block offset, uint32 record size
+
+Bit i of a hit's flags is set when the hit belongs to the i-th configured signature tool.
+Compressed shards need the zstandard module.
+
+Usage: read_training_samples.py <shard.bin | index> [n_samples]
+"""
+
+import sys
+
+import numpy as np
+
+FILE_MAGIC = b"SFSTRAIN"
+INDEX_MAGIC = b"SFSINDEX"
+GLOBAL_INDEX_MAGIC = b"SFSGINDX"
+VERSION = 1
+COMPRESSION_NONE = 0
+COMPRESSION_ZSTD = 1
+
+FILE_HEADER = np.dtype([("magic", "S8"), ("version", "<u4"), ("compression", "<u4"), ("view", "<u4"), ("reserved", "<u4")])
+BLOCK_HEADER = np.dtype([("raw_size", "<u4"), ("stored_size", "<u4")])
+FOOTER = np.dtype([("index_offset", "<u8"), ("magic", "S8")])
+INDEX_ENTRY = np.dtype([("block_offset", "<u8"), ("offset_in_block", "<u4"), ("size", "<u4")])
+GLOBAL_INDEX_ENTRY = np.dtype([("shard", "<u4"), ("offset_in_block", "<u4"), ("block_offset", "<u8"), ("size", "<u4")])
+SAMPLE_HEADER = np.dtype([("n_hits", "<u4"), ("n_flags", "<u4"), ("run", "<u4"), ("subrun", "<u4"), ("event", "<u4"),
+                          ("height", "<u4"), ("width", "<u4"), ("x_vtx", "<f4"), ("z_vtx", "<f4"),
+                          ("drift_min", "<f4"), ("drift_max", "<f4"), ("wire_min", "<f4"), ("wire_max", "<f4")])
+HIT = np.dtype([("x", "<f4"), ("z", "<f4"), ("q", "<f4"), ("flags", "<u4")])
+
+
+def decode_sample(data):
+    """Returns the record header as a dict and its hits as a structured array with x, z, q and flags."""
+    if len(data) < SAMPLE_HEADER.itemsize:
+        raise ValueError("truncated record")
+
+    header = np.frombuffer(data, SAMPLE_HEADER, count=1)[0]
+    n_hits = int(header["n_hits"])
+    if len(data) != SAMPLE_HEADER.itemsize + n_hits * HIT.itemsize:
+        raise ValueError("record size does not match its hit count")
+
+    hits = np.frombuffer(data, HIT, count=n_hits, offset=SAMPLE_HEADER.itemsize)
+    return {name: header[name].item() for name in SAMPLE_HEADER.names}, hits
+
+
+class ShardReader:
+    """Random access to the records of one shard, keeping the last decoded block."""
+
+    def __init__(self, path):
+        self.path = path
+        self._file = open(path, "rb")
+
+        header = np.frombuffer(self._read(0, FILE_HEADER.itemsize), FILE_HEADER)[0]
+        if header["magic"] != FILE_MAGIC:
+            raise ValueError(f"{path} is not a training sample file")
+        if header["version"] != VERSION:
+            raise ValueError(f"{path} has format version {header['version']}, expected {VERSION}")
+
+        self.compression = int(header["compression"])
+        self.view = int(header["view"])
+
+        self._file.seek(0, 2)
+        file_size = self._file.tell()
+        if file_size < FILE_HEADER.itemsize + FOOTER.itemsize:
+            raise ValueError(f"{path} has no index, the writer was not closed")
+        footer = np.frombuffer(self._read(file_size - FOOTER.itemsize, FOOTER.itemsize), FOOTER)[0]
+        if footer["magic"] != INDEX_MAGIC:
+            raise ValueError(f"{path} has no index, the writer was not closed")
+
+        index_offset = int(footer["index_offset"])
+        n_records = int(np.frombuffer(self._read(index_offset, 8), "<u8")[0])
+        self.index = np.frombuffer(self._read(index_offset + 8, n_records * INDEX_ENTRY.itemsize), INDEX_ENTRY)
+
+        self._block_offset = None
+        self._block = None
+
+    def __len__(self):
+        return len(self.index)
+
+    def __getitem__(self, i):
+        entry = self.index[i]
+        return self.read(int(entry["block_offset"]), int(entry["offset_in_block"]), int(entry["size"]))
+
+    def __iter__(self):
+        for i in range(len(self)):
+            yield self[i]
+
+    def read(self, block_offset, offset_in_block, size):
+        """Decodes a record located through this shard's index or a global index."""
+        block = self._load_block(block_offset)
+        if offset_in_block + size > len(block):
+            raise ValueError(f"record extends past its block in {self.path}")
+        return decode_sample(block[offset_in_block:offset_in_block + size])
+
+    def close(self):
+        self._file.close()
+
+    def _load_block(self, block_offset):
+        if self._block_offset == block_offset:
+            return self._block
+
+        header = np.frombuffer(self._read(block_offset, BLOCK_HEADER.itemsize), BLOCK_HEADER)[0]
+        raw_size, stored_size = int(header["raw_size"]), int(header["stored_size"])
+        stored = self._read(block_offset + BLOCK_HEADER.itemsize, stored_size)
+
+        if self.compression == COMPRESSION_NONE:
+            block = stored
+        elif self.compression == COMPRESSION_ZSTD:
+            import zstandard
+            block = zstandard.ZstdDecompressor().decompress(stored, max_output_size=raw_size)
+            if len(block) != raw_size:
+                raise ValueError(f"corrupt zstd block in {self.path}")
+        else:
+            raise ValueError(f"{self.path} has unknown compression {self.compression}")
+
+        self._block_offset = block_offset
+        self._block = block
+        return block
+
+    def _read(self, offset, size):
+        self._file.seek(offset)
+        data = self._file.read(size)
+        if len(data) != size:
+            raise ValueError(f"unexpected end of {self.path}")
+        return data
+
+
+class IndexReader:
+    """Records of one view across many shards, read in place through per-shard readers."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            data = f.read()
+
+        if data[:8] != GLOBAL_INDEX_MAGIC:
+            raise ValueError(f"{path} is not a training sample index")
+
+        self.view = int(np.frombuffer(data, "<u4", count=1, offset=12)[0])
+        pos = 16
+        n_shards = int(np.frombuffer(data, "<u4", count=1, offset=pos)[0])
+        pos += 4
+
+        self.shards = []
+        for _ in range(n_shards):
+            length = int(np.frombuffer(data, "<u4", count=1, offset=pos)[0])
+            pos += 4
+            self.shards.append(data[pos:pos + length].decode())
+            pos += length
+
+        n_records = int(np.frombuffer(data, "<u8", count=1, offset=pos)[0])
+        pos += 8
+        if pos + n_records * GLOBAL_INDEX_ENTRY.itemsize > len(data):
+            raise ValueError(f"truncated index {path}")
+        self.entries = np.frombuffer(data, GLOBAL_INDEX_ENTRY, count=n_records, offset=pos)
+
+        self._readers = {}
+
+    def __len__(self):
+        return len(self.entries)
+
+    def __getitem__(self, i):
+        entry = self.entries[i]
+        shard = int(entry["shard"])
+        if shard not in self._readers:
+            self._readers[shard] = ShardReader(self.shards[shard])
+        return self._readers[shard].read(int(entry["block_offset"]), int(entry["offset_in_block"]), int(entry["size"]))
+
+    def __iter__(self):
+        for i in range(len(self)):
+            yield self[i]
+
+
+def open_samples(path):
+    """Opens a shard or a global index by its magic."""
+    with open(path, "rb") as f:
+        magic = f.read(8)
+    if magic == GLOBAL_INDEX_MAGIC:
+        return IndexReader(path)
+    return ShardReader(path)
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__.strip().splitlines()[-1], file=sys.stderr)
+        return 1
+
+    samples = open_samples(sys.argv[1])
+    n_show = int(sys.argv[2]) if len(sys.argv) > 2 else 5
+
+    print(f"{sys.argv[1]}: view {samples.view}, {len(samples)} samples")
+    for i in range(min(n_show, len(samples))):
+        header, hits = samples[i]
+        n_flagged = int(np.count_nonzero(hits["flags"]))
+        print(f"  {header['run']}:{header['subrun']}:{header['event']}  {header['n_hits']} hits, "
+              f"{n_flagged} with signature flags, total charge {hits['q'].sum():.1f}")
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
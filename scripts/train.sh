@@ -1 +1 @@
-rm -f training_output_*.csv
\ No newline at end of file
+rm -f training_output_*.bin
\ No newline at end of file